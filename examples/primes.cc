@@ -137,17 +137,18 @@ thp::generator<PrimeBits<T, N>> lazy_prime(thp::threadpool& tp, const T n) {
     // increase seive
     auto bigs = smalls;
     const auto seive_limits = static_cast<T>(sqrt(numeric_limits<uint64_t>::max()));
-    vector<std::future<ReturnType>> futs;
+    vector<thp::future<ReturnType>> futs;
     for(T i = 1+smalls.back(); i <= seive_limits; i += step)
       futs.emplace_back(tp.submit(find_prime<T, N>, cref(smalls), i, min(i+step, seive_limits)));
 
-    rng::for_each(futs, [&](auto&& fut) { fut.get().copy_to(back_inserter(bigs)); });
+    auto done = thp::util::when_all(futs.begin(), futs.end()).get();
+    rng::for_each(done, [&](auto&& fut) { fut.get().copy_to(back_inserter(bigs)); });
 
     exchange(smalls, move(bigs));
   }
 
   co_yield move(sieve_bits);
-  vector<std::future<ReturnType>> futs;
+  vector<thp::future<ReturnType>> futs;
   for (T i = step; i < n; i += step)
     futs.emplace_back(tp.submit(find_prime<T, N>, cref(smalls), i, min(i+step, n)));
 
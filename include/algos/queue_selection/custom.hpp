@@ -13,8 +13,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
-#ifndef FAIRSHARE_HPP_
-#define FAIRSHARE_HPP_
+#ifndef CUSTOM_HPP_
+#define CUSTOM_HPP_
 
 #include "include/algos/queue_selection/queue_selection_algo.hpp"
 #include "include/statistics.hpp"
@@ -42,4 +42,4 @@ struct custom_algo : queue_selection_algo {
 } // namespace sched_algos
 } // namespace thp
 
-#endif // FAIRSHARE_HPP_
+#endif // CUSTOM_HPP_
@@ -16,10 +16,10 @@ limitations under the License.
 #ifndef FAIRSHARE_HPP_
 #define FAIRSHARE_HPP_
 
-#include <thread>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <vector>
-#include <random>
-#include <ranges>
 
 #include "include/algos/queue_selection/queue_selection_algo.hpp"
 #include "include/statistics.hpp"
@@ -27,24 +27,61 @@ limitations under the License.
 namespace thp {
 namespace algos {
 namespace queue_select {
-class fairshare_algo : public queue_selection_algo {
-private:
-  std::random_device rd;
 
+// weighted fair share over the task queues of stats.jobq.in.qs, stride
+// scheduling. every pick of a queue advances its pass by a stride inversely
+// proportional to its weight and the non-empty queue with the lowest pass
+// is picked. a queue coming back from empty starts at the lowest pass of
+// the others, idle time earns no credit.
+// a pick hands one worker to the queue for at most one time slice (see
+// task_queue::time_slice), so shares of picks are shares of worker time for
+// queues that keep their workers busy. not thread safe, one instance per
+// picking thread.
+class fairshare_algo : public queue_selection_algo {
 public:
-  explicit fairshare_algo() : rd{} {}
+  // weights[i] of i-th queue, one per queue, zero counts as 1
+  explicit fairshare_algo(std::vector<unsigned> weights)
+      : weights_{std::move(weights)}, pass_(weights_.size(), 0), active_(weights_.size(), false) {}
 
   task_queue* apply(const statistics& stats) noexcept override {
-    return nullptr;
+    const auto& qs = stats.jobq.in.qs;
+    const auto n = std::min(qs.size(), weights_.size());
+
+    std::uint64_t lowest = std::numeric_limits<std::uint64_t>::max();
+    for (std::size_t i = 0; i < n; ++i)
+      if (active_[i] && !qs[i]->empty())
+        lowest = std::min(lowest, pass_[i]);
+
+    std::size_t best = n;
+    for (std::size_t i = 0; i < n; ++i) {
+      const bool ready = !qs[i]->empty();
+      if (ready && !active_[i] && lowest != std::numeric_limits<std::uint64_t>::max())
+        pass_[i] = std::max(pass_[i], lowest);
+      active_[i] = ready;
+      if (ready && (best == n || pass_[i] < pass_[best]))
+        best = i;
+    }
+    if (best == n)
+      return nullptr;
+
+    pass_[best] += Stride / weight(best);
+    return qs[best];
+  }
+
+private:
+  static constexpr std::uint64_t Stride = 1u << 20;
+
+  std::uint64_t weight(std::size_t i) const noexcept {
+    return std::max(weights_[i], 1u);
   }
 
-  // int apply(statistics& stats, std::thread::id tid) override {
-  //   return 0;
-  // }
+  std::vector<unsigned> weights_;
+  std::vector<std::uint64_t> pass_;
+  std::vector<bool> active_;
 };
 
-}
-} // namespace sched_algos
+} // namespace queue_select
+} // namespace algos
 } // namespace thp
 
 #endif // FAIRSHARE_HPP_
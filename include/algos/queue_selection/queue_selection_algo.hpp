@@ -37,6 +37,7 @@ enum names : uint8_t {
 struct queue_selection_algo {
   constexpr virtual bool ok(statistics &) noexcept { return false; }
   constexpr virtual task_queue *apply(const statistics &) noexcept = 0;
+  constexpr virtual ~queue_selection_algo() = default;
 };
 
 } // namespace queue_select
@@ -43,13 +43,16 @@ struct oneshot {
         case stop_source_state_t::stopped:
           return;
           break;
+        case stop_source_state_t::paused:
+          me.sleep(); // resume wakes us
+          break;
         case stop_source_state_t::running: {
           if (auto q = jobq_.best_queue(stats_)) {
-            while (!q->empty()) {
-              auto &w = worker_pool_.free_worker(stats_);
-              w.serve(q);
-              w.wakeup();
-            }
+            // one worker per pick, so the queue selection sees every
+            // worker handed out
+            auto &w = worker_pool_.free_worker(stats_);
+            w.serve(q);
+            w.wakeup();
           }
           else {
             me.sleep(); // no task
@@ -75,15 +78,26 @@ struct oneshot {
           return;
           break;
         case stop_source_state_t::paused:
-          worker_pool_.not_working(idx);
+          // a task handed off is ours, it must not be lost by retiring
+          if (me.retiring()) {
+            me.run_handoff();
+            return;
+          }
+          // with a handoff waiting we stay claimed, resume wakes us
+          if (!me.has_handoff())
+            worker_pool_.not_working(idx);
           me.sleep();
           break;
         case stop_source_state_t::running:
-          if (nullptr != (q = me.my_queue())) {
+          me.run_handoff();
+          if (me.retiring())
+            return;
+          if (nullptr != (q = me.my_queue()))
             q->accept(me);
-            worker_pool_.not_working(idx);
+          // a handoff landing after the check above is run on next wakeup
+          worker_pool_.not_working(idx);
+          if (!worker_pool_.find_work(idx, me))
             me.sleep();
-          }
           break;
         default:
           break;
@@ -16,7 +16,6 @@ limitations under the License.
 #ifndef WAITING_HPP__
 #define WAITING_HPP__
 
-#include "include/algos/queue_selection/first_available.hpp"
 #include "include/all_priority_types.hpp"
 #include "include/job_queue.hpp"
 #include "include/managed_stop_token.hpp"
@@ -34,10 +33,8 @@ struct waiting {
       : stats_{stats}, jobq_{jobq}, worker_pool_{pool}
       , managers_pool_{managers} {
     scheduler_fn_ = [&](managed_stop_token st) {
+      auto [_, me] = managers_pool_.worker_info(std::this_thread::get_id()).value();
       task_queue *q = nullptr;
-      std::condition_variable_any no_task_cond;
-      std::shared_mutex mu;
-      algos::queue_select::first_available qs;
 
       while (true) {
         const auto state = st.current_state();
@@ -45,6 +42,9 @@ struct waiting {
         case stop_source_state_t::stopped:
           return;
           break;
+        case stop_source_state_t::paused:
+          me.sleep(); // resume wakes us
+          break;
         case stop_source_state_t::running:
           if (nullptr != (q = jobq_.best_queue(stats_))) {
             auto &w = worker_pool_.free_worker(stats_);
@@ -54,13 +54,9 @@ struct waiting {
             // std::cerr << "scheduler_fn: " << q->size() << ", free: " <<
             // w.get_id() << '\n';
           } else {
-            // go into polling mode
-            std::unique_lock l(mu);
-            do {
-              if (st.stop_requested())
-                break;
-            } while (no_task_cond.wait_for(l, st, std::chrono::microseconds(50),
-                                           [&] { return !qs.apply(stats_); }));
+            // submit wakes us, a wakeup racing with the check above is kept
+            // as a permit so park returns right away
+            me.sleep();
           }
           break;
 
@@ -82,10 +78,20 @@ struct waiting {
           return;
           break;
         case stop_source_state_t::paused:
-          worker_pool_.not_working(idx);
+          // a task handed off is ours, it must not be lost by retiring
+          if (me.retiring()) {
+            me.run_handoff();
+            return;
+          }
+          // with a handoff waiting we stay claimed, resume wakes us
+          if (!me.has_handoff())
+            worker_pool_.not_working(idx);
           me.sleep();
           break;
         case stop_source_state_t::running:
+          me.run_handoff();
+          if (me.retiring())
+            return;
           q = q ? q : me.my_queue();
           // std::this_thread::sleep_for(std::chrono::milliseconds(1000));
           if (q) {
@@ -93,9 +99,10 @@ struct waiting {
             // w.get_id() << '\n'; worker_pool_.working(id);
             q->accept(me);
             q = nullptr;
-            worker_pool_.not_working(idx);
-            me.sleep();
           }
+          worker_pool_.not_working(idx);
+          if (!worker_pool_.find_work(idx, me))
+            me.sleep();
           break;
         default:
           break;
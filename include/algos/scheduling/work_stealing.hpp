@@ -0,0 +1,225 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef WORK_STEALING_HPP__
+#define WORK_STEALING_HPP__
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "include/algos/queue_selection/fair_share.hpp"
+#include "include/all_priority_types.hpp"
+#include "include/chase_lev_deque.hpp"
+#include "include/job_queue.hpp"
+#include "include/managed_stop_token.hpp"
+#include "include/slab_allocator.hpp"
+#include "include/statistics.hpp"
+#include "include/worker.hpp"
+#include "include/worker_pool.hpp"
+
+namespace thp {
+namespace algos {
+namespace scheduler {
+
+// every worker owns a deque, tasks submitted from a worker stay on its own
+// deque, idle workers take from job queue or steal from random victims.
+// scheduler thread only wakes idle workers for externally submitted tasks.
+// with job_queue::fair_share every worker picks job queues by its own
+// stride pick over the same weights.
+struct work_stealing {
+  using deque_type = ds::chase_lev_deque<simple_task, ds::slab_delete<simple_task>>;
+
+  explicit work_stealing(statistics &stats, job_queue<TaskQueueTupleType> &jobq,
+                         worker_pool<worker> &pool, worker_pool<worker> &managers)
+      : stats_{stats}, jobq_{jobq}, worker_pool_{pool}
+      , managers_pool_{managers}, deques_{}, pickers_(pool.size())
+  {
+    for (unsigned i = 0; i < worker_pool_.size(); ++i)
+      deques_.emplace_back(std::make_unique<deque_type>());
+
+    scheduler_fn_ = [&](managed_stop_token st) noexcept {
+      auto [_, me] = managers_pool_.worker_info(std::this_thread::get_id()).value();
+
+      while (true) {
+        const auto state = st.current_state();
+        switch (state) {
+        case stop_source_state_t::stopped:
+          return;
+          break;
+        case stop_source_state_t::paused:
+          me.sleep(); // resume wakes us
+          break;
+        case stop_source_state_t::running: {
+          // wake as many idle workers as there are queued tasks
+          auto pending = queued_tasks();
+          while (pending-- > 0) {
+            if (auto w = worker_pool_.try_free_worker())
+              w->wakeup();
+            else
+              break;
+          }
+          me.sleep();
+        }
+        break;
+
+        default:
+          break;
+        }
+      }
+    };
+
+    worker_fn_ = [&](managed_stop_token st) noexcept {
+      auto [idx, me] = worker_pool_.worker_info(std::this_thread::get_id()).value();
+      std::minstd_rand rnd{idx + 1};
+      current_ = {this, idx};
+      if (!jobq_.weights().empty())
+        pickers_[idx] = std::make_unique<queue_select::fairshare_algo>(jobq_.weights());
+
+      while (true) {
+        const auto state = st.current_state();
+        switch (state) {
+        case stop_source_state_t::stopped:
+          current_ = {nullptr, 0};
+          return;
+          break;
+        case stop_source_state_t::paused:
+          // a task handed off is ours, it must not be lost by retiring
+          if (me.retiring()) {
+            me.run_handoff();
+            current_ = {nullptr, 0};
+            return;
+          }
+          // with a handoff waiting we stay claimed, resume wakes us
+          if (!me.has_handoff())
+            worker_pool_.not_working(idx);
+          me.sleep();
+          break;
+        case stop_source_state_t::running:
+          if (me.retiring()) {
+            // claimed while idle, so its deque is empty
+            me.run_handoff();
+            current_ = {nullptr, 0};
+            return;
+          }
+          if (!run_one(idx, me, rnd, false)) {
+            worker_pool_.not_working(idx);
+            // recheck after publishing idle state, a submitter either sees
+            // us idle and wakes us, or we see its task here
+            if (worker_pool_.find_work(idx, me))
+              break;
+            if (!has_work() || !worker_pool_.claim(idx))
+              me.sleep();
+          }
+          break;
+        default:
+          break;
+        }
+      }
+    };
+  }
+
+  // pushes on the calling worker's own deque, false if caller is not our worker
+  bool schedule_local(simple_task &t) {
+    if (current_.algo != this)
+      return false;
+
+    deques_[current_.idx]->push(ds::make_slab<simple_task>(std::move(t)));
+    if (auto w = worker_pool_.try_free_worker())
+      w->wakeup();
+    return true;
+  }
+
+  // one task for worker idx while it waits on a result
+  bool help_one(unsigned idx, worker &me) noexcept {
+    thread_local std::minstd_rand rnd{idx + 1};
+    return run_one(idx, me, rnd, true);
+  }
+
+protected:
+  // one task, or one time slice of a fair share pick unless only_one
+  bool run_one(unsigned idx, worker &me, std::minstd_rand &rnd, bool only_one) noexcept {
+    if (me.run_handoff())
+      return true;
+
+    if (auto t = deques_[idx]->pop()) {
+      t->execute();
+      return true;
+    }
+
+    if (auto &picker = pickers_[idx]) {
+      if (auto q = picker->apply(stats_)) {
+        if (only_one)
+          return q->accept_one(me);
+        q->accept(me);
+        return true;
+      }
+    } else {
+      for (auto q : stats_.jobq.in.qs) {
+        if (q->accept_one(me))
+          return true;
+      }
+    }
+
+    const auto n = static_cast<unsigned>(deques_.size());
+    for (unsigned i = 0; n > 1 && i < n; ++i) {
+      const auto victim = rnd() % n;
+      if (victim == idx)
+        continue;
+      if (auto t = deques_[victim]->steal()) {
+        t->execute();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool has_work() const noexcept {
+    return queued_tasks() > 0 ||
+           std::ranges::any_of(deques_, [](auto &&d) { return !d->empty(); });
+  }
+
+  std::size_t queued_tasks() const noexcept {
+    std::size_t n = 0;
+    for (auto q : stats_.jobq.in.qs)
+      n += q->servable_size();
+    return n;
+  }
+
+  struct context {
+    work_stealing *algo;
+    unsigned idx;
+  };
+
+  static inline thread_local context current_{nullptr, 0};
+
+public:
+  statistics &stats_;
+  job_queue<TaskQueueTupleType> &jobq_;
+  worker_pool<worker> &worker_pool_;
+  worker_pool<worker> &managers_pool_;
+  std::vector<std::unique_ptr<deque_type>> deques_;
+  // per worker, only its own worker touches it
+  std::vector<std::unique_ptr<queue_select::fairshare_algo>> pickers_;
+
+  std::function<void(managed_stop_token)> scheduler_fn_, worker_fn_;
+};
+
+} // namespace scheduler
+} // namespace algos
+} // namespace thp
+
+#endif // WORK_STEALING_HPP__
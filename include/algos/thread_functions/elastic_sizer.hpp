@@ -0,0 +1,98 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef ELASTIC_SIZER_HPP__
+#define ELASTIC_SIZER_HPP__
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+#include "include/statistics.hpp"
+
+namespace thp {
+
+struct elastic_options {
+  unsigned min_threads = 0;                     // 0 keeps the pool at max_threads
+  unsigned backlog = 1;                         // queued tasks per running worker taken as backlog
+  std::chrono::milliseconds grow_after{1};      // backlog lasting this long adds workers
+  std::chrono::milliseconds keep_alive{10000};  // workers idle all this long retire
+};
+
+namespace algos {
+
+// decides the size of an elastic pool from statistics, asked on every
+// tick of the pool's book keeper.
+// backlog with no idle worker for grow_after starts enough workers for
+// backlog tasks each, up to max. workers which stayed idle over a whole
+// keep_alive window retire, down to min.
+struct elastic_sizer {
+  using clock = std::chrono::steady_clock;
+
+  elastic_sizer(const elastic_options &opts, unsigned max_threads,
+                clock::time_point now = clock::now()) noexcept
+      : opts_{opts}, min_{std::min(opts.min_threads, max_threads)}, max_{max_threads},
+        backlog_since_{none()}, window_start_{now}, min_idle_{std::numeric_limits<unsigned>::max()} {}
+
+  // workers to start (> 0) or to retire (< 0). stats.pool.num_threads are
+  // running workers, num_workers the busy ones among them, and
+  // stats.jobq.in.num_tasks the queued tasks
+  int resize(const statistics &stats, clock::time_point now = clock::now()) noexcept {
+    const unsigned running = stats.pool.num_threads;
+    const unsigned idle = running - std::min<unsigned>(stats.pool.num_workers, running);
+    const unsigned depth = stats.jobq.in.num_tasks;
+    const unsigned per_worker = std::max(opts_.backlog, 1u);
+
+    if (idle == 0 && depth > per_worker * running) {
+      backlog_since_ = std::min(backlog_since_, now);
+    } else {
+      backlog_since_ = none();
+    }
+
+    if (backlog_since_ != none() && now - backlog_since_ >= opts_.grow_after && running < max_) {
+      backlog_since_ = none();
+      restart_window(now);
+      const unsigned wanted = std::clamp((depth + per_worker - 1) / per_worker, running + 1, max_);
+      return static_cast<int>(wanted - running);
+    }
+
+    min_idle_ = std::min(min_idle_, idle);
+    if (now - window_start_ >= opts_.keep_alive) {
+      const unsigned surplus = std::min(min_idle_, running - std::min(running, min_));
+      restart_window(now);
+      return -static_cast<int>(surplus);
+    }
+    return 0;
+  }
+
+private:
+  static constexpr clock::time_point none() noexcept { return clock::time_point::max(); }
+
+  void restart_window(clock::time_point now) noexcept {
+    window_start_ = now;
+    min_idle_ = std::numeric_limits<unsigned>::max();
+  }
+
+  elastic_options opts_;
+  unsigned min_, max_;
+  clock::time_point backlog_since_; // none() without backlog
+  clock::time_point window_start_;
+  unsigned min_idle_;
+};
+
+} // namespace algos
+} // namespace thp
+
+#endif // ELASTIC_SIZER_HPP__
@@ -19,12 +19,14 @@ limitations under the License.
 #include <chrono>
 #include <tuple>
 
+#include "include/mpmc_queue.hpp"
+#include "include/multi_queue.hpp"
 #include "include/task_type.hpp"
 #include "include/task_queue.hpp"
 
 namespace thp {
 
-using AllPriority = std::tuple<void, int>;
+using AllPriority = std::tuple<void, int, deadline_clock::time_point>;
 
 using AllPriority2 = std::tuple<
     void,
@@ -40,12 +42,40 @@ using AllOneshotTasks = std::tuple<
   simple_task
 >;
 
+// storage backend of task queue per priority type
+template<typename P>
+struct TaskQueueFor {
+  using type = priority_taskq<P>;
+};
+
+// fifo tasks go through lock free ring
+template<>
+struct TaskQueueFor<void> {
+  using type = priority_taskq<void, ds::mpmc_workq<simple_task>>;
+};
+
+// relaxed priority order, see multi_queue.hpp for rank error bound
+template<>
+struct TaskQueueFor<int> {
+  using type = priority_taskq<int, ds::multi_workq<priority_task<int>,
+                                                   std::less<priority_task<int>>>>;
+};
+
+// earliest deadline first
+template<>
+struct TaskQueueFor<deadline_clock::time_point> {
+  using type = deadline_taskq;
+};
+
+template<typename P>
+using TaskQueueFor_t = typename TaskQueueFor<P>::type;
+
 template<typename T>
 struct PriorityTaskQueueTuple;
 
 template<typename...Ts>
 struct PriorityTaskQueueTuple<std::tuple<Ts...>> {
-  using type = std::tuple<priority_taskq<Ts>...>;
+  using type = std::tuple<TaskQueueFor_t<Ts>...>;
 };
 
 using PriorityTaskQueueTupleType = PriorityTaskQueueTuple<AllPriority>::type;
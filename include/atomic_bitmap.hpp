@@ -0,0 +1,144 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef ATOMIC_BITMAP_HPP_
+#define ATOMIC_BITMAP_HPP_
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include "include/configuration.hpp"
+#include "platform/eventcount.hpp"
+
+namespace thp {
+namespace ds {
+
+// two level atomic bitmap, summary word has bit l set when leaf word l may
+// have a set bit. find-and-clear is two ctz per level, set touches summary
+// only when a leaf goes from empty to non-empty. each leaf owns a cache line.
+struct atomic_bitmap {
+  using word_type = std::uint64_t;
+  static constexpr unsigned BitsPerWord = CHAR_BIT * sizeof(word_type);
+  static constexpr unsigned MaxBits = BitsPerWord * BitsPerWord;
+
+  explicit atomic_bitmap(unsigned nbits)
+      : nbits_{nbits}, summary_{0},
+        leaves_{std::make_unique<leaf[]>((nbits + BitsPerWord - 1) / BitsPerWord)} {
+    if (nbits > MaxBits)
+      throw std::logic_error("atomic_bitmap: requested size is greater");
+  }
+
+  atomic_bitmap(const atomic_bitmap &) = delete;
+  atomic_bitmap &operator=(const atomic_bitmap &) = delete;
+
+  void set(unsigned idx) noexcept {
+    const auto l = idx / BitsPerWord;
+    const auto old = leaves_[l].bits.fetch_or(bit(idx % BitsPerWord), std::memory_order_seq_cst);
+    if (old == 0)
+      summary_.fetch_or(bit(l), std::memory_order_seq_cst);
+    waiters_.notify_one();
+  }
+
+  // true if this call cleared the bit
+  bool reset(unsigned idx) noexcept {
+    const auto l = idx / BitsPerWord;
+    const auto b = bit(idx % BitsPerWord);
+    const auto old = leaves_[l].bits.fetch_and(~b, std::memory_order_seq_cst);
+    if (!(old & b))
+      return false;
+
+    if (old == b) {
+      // leaf went empty, a concurrent set may have raced with us
+      summary_.fetch_and(~bit(l), std::memory_order_seq_cst);
+      if (leaves_[l].bits.load(std::memory_order_seq_cst) != 0) {
+        summary_.fetch_or(bit(l), std::memory_order_seq_cst);
+        waiters_.notify_one();
+      }
+    }
+    return true;
+  }
+
+  // finds a set bit and clears it
+  std::optional<unsigned> acquire_any() noexcept {
+    auto s = summary_.load(std::memory_order_seq_cst);
+    while (s) {
+      const auto l = static_cast<unsigned>(__builtin_ctzll(s));
+      auto w = leaves_[l].bits.load(std::memory_order_seq_cst);
+      while (w) {
+        const auto b = static_cast<unsigned>(__builtin_ctzll(w));
+        const auto idx = l * BitsPerWord + b;
+        if (reset(idx))
+          return idx;
+        w = leaves_[l].bits.load(std::memory_order_relaxed);
+      }
+      s &= ~bit(l);
+    }
+    return std::nullopt;
+  }
+
+  // blocks till some bit is set, then finds and clears it
+  unsigned wait_acquire_any() noexcept {
+    while (true) {
+      if (auto idx = acquire_any())
+        return idx.value();
+
+      const auto key = waiters_.prepare_wait();
+      if (auto idx = acquire_any()) {
+        waiters_.cancel_wait();
+        return idx.value();
+      }
+      waiters_.wait(key);
+    }
+  }
+
+  [[nodiscard]] bool test(unsigned idx) const noexcept {
+    return leaves_[idx / BitsPerWord].bits.load(std::memory_order_relaxed) &
+           bit(idx % BitsPerWord);
+  }
+
+  [[nodiscard]] bool none() const noexcept {
+    return summary_.load(std::memory_order_relaxed) == 0;
+  }
+
+  [[nodiscard]] unsigned size() const noexcept { return nbits_; }
+
+  // set bits, a snapshot only while others set and reset concurrently
+  [[nodiscard]] unsigned count() const noexcept {
+    unsigned n = 0;
+    for (unsigned l = 0; l < (nbits_ + BitsPerWord - 1) / BitsPerWord; ++l)
+      n += static_cast<unsigned>(__builtin_popcountll(leaves_[l].bits.load(std::memory_order_relaxed)));
+    return n;
+  }
+
+private:
+  static constexpr word_type bit(unsigned i) noexcept { return word_type{1} << i; }
+
+  struct alignas(hardware_destructive_interference_size) leaf {
+    std::atomic<word_type> bits{0};
+  };
+
+  unsigned nbits_;
+  alignas(hardware_destructive_interference_size) std::atomic<word_type> summary_;
+  std::unique_ptr<leaf[]> leaves_;
+  platform::event_count waiters_;
+};
+
+} // namespace ds
+} // namespace thp
+
+#endif // ATOMIC_BITMAP_HPP_
@@ -0,0 +1,168 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef BATCH_FUTURE_HPP_
+#define BATCH_FUTURE_HPP_
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace thp {
+
+// selects bulk overloads, e.g. make_task(thp::bulk, fn, range)
+struct bulk_t {
+  explicit bulk_t() = default;
+};
+inline constexpr bulk_t bulk{};
+
+// completion counter of a batch, keeps first exception thrown by a task
+struct batch_counter {
+  explicit batch_counter(std::size_t n) : pending_{n}, size_{n} {}
+
+  // records e, if it is first failure of the batch
+  void set_exception(std::exception_ptr e) noexcept {
+    if (!failed_.test_and_set(std::memory_order_relaxed))
+      error_ = std::move(e);
+  }
+
+  // one task done, successful or not
+  void finish() noexcept {
+    if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      pending_.notify_all();
+  }
+
+  bool ready() const noexcept {
+    return pending_.load(std::memory_order_acquire) == 0;
+  }
+
+  void wait() const noexcept {
+    for (auto n = pending_.load(std::memory_order_acquire); n != 0;
+         n = pending_.load(std::memory_order_acquire))
+      pending_.wait(n, std::memory_order_acquire);
+  }
+
+  std::size_t size() const noexcept { return size_; }
+
+protected:
+  void rethrow_if_failed() const {
+    if (error_)
+      std::rethrow_exception(error_);
+  }
+
+  std::atomic<std::size_t> pending_;
+  std::atomic_flag failed_;
+  std::exception_ptr error_;
+  std::size_t size_;
+};
+
+// shared state of a batch, every task fills its own result slot
+template <typename Ret>
+struct batch_state : batch_counter {
+  explicit batch_state(std::size_t n) : batch_counter(n), results_(n) {}
+
+  void set_value(std::size_t idx, Ret &&v) {
+    results_[idx].emplace(std::move(v));
+  }
+
+  std::vector<Ret> get() {
+    wait();
+    rethrow_if_failed();
+
+    std::vector<Ret> v;
+    v.reserve(results_.size());
+    for (auto &&r : results_)
+      v.emplace_back(std::move(r.value()));
+    return v;
+  }
+
+protected:
+  std::vector<std::optional<Ret>> results_;
+};
+
+template <>
+struct batch_state<void> : batch_counter {
+  using batch_counter::batch_counter;
+
+
+  void get() {
+    wait();
+    rethrow_if_failed();
+  }
+};
+
+// one future for a whole batch of tasks, get() returns results in
+// submission order or rethrows the first exception thrown by any task
+template <typename Ret>
+struct batch_future {
+  batch_future() = default;
+  explicit batch_future(std::shared_ptr<batch_state<Ret>> st) : st_{std::move(st)} {}
+
+  [[nodiscard]] bool valid() const noexcept { return st_ != nullptr; }
+  [[nodiscard]] bool ready() const noexcept { return st_->ready(); }
+  [[nodiscard]] std::size_t size() const noexcept { return st_->size(); }
+
+  void wait() const noexcept { st_->wait(); }
+
+  // waits for all tasks, invalidates the future
+  decltype(auto) get() {
+    auto st = std::move(st_);
+    return st->get();
+  }
+
+private:
+  std::shared_ptr<batch_state<Ret>> st_;
+};
+
+// tasks of one batch share fn and arguments, a task is just its index
+template <typename Fn, typename Arg>
+struct batch_job : batch_state<std::invoke_result_t<const Fn &, Arg>> {
+  using Ret = std::invoke_result_t<const Fn &, Arg>;
+
+  template <typename F>
+  batch_job(F &&fn, std::vector<Arg> &&args)
+      : batch_state<Ret>(args.size()), fn_{std::forward<F>(fn)}, args_{std::move(args)} {}
+
+  void run(std::size_t idx) noexcept {
+    try {
+      if constexpr (std::is_void_v<Ret>)
+        std::invoke(std::as_const(fn_), std::move(args_[idx]));
+      else
+        this->set_value(idx, std::invoke(std::as_const(fn_), std::move(args_[idx])));
+    } catch (...) {
+      this->set_exception(std::current_exception());
+    }
+    this->finish();
+  }
+
+  struct item {
+    std::shared_ptr<batch_job> job;
+    std::size_t idx;
+
+    void operator()() noexcept { job->run(idx); }
+  };
+
+private:
+  Fn fn_;
+  std::vector<Arg> args_;
+};
+
+} // namespace thp
+
+#endif // BATCH_FUTURE_HPP_
@@ -0,0 +1,154 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef CHASE_LEV_DEQUE_HPP_
+#define CHASE_LEV_DEQUE_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "include/configuration.hpp"
+
+namespace thp {
+namespace ds {
+
+// work stealing deque (Chase-Lev, with C11 orderings from Le et al. 2013)
+// owner thread does push/pop at bottom, any thread may steal from top.
+// stores owning pointers, retired buffers are kept till destruction.
+template <typename T, typename Deleter = std::default_delete<T>>
+struct chase_lev_deque {
+  using pointer = std::unique_ptr<T, Deleter>;
+
+  explicit chase_lev_deque(std::size_t capacity = 256)
+      : top_{0}, bottom_{0}, buf_{nullptr}, retired_{} {
+    std::size_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+    retired_.emplace_back(std::make_unique<ring>(cap));
+    buf_.store(retired_.back().get(), std::memory_order_relaxed);
+  }
+
+  chase_lev_deque(const chase_lev_deque &) = delete;
+  chase_lev_deque &operator=(const chase_lev_deque &) = delete;
+
+  // owner only
+  void push(pointer x) {
+    const auto b = bottom_.load(std::memory_order_relaxed);
+    const auto t = top_.load(std::memory_order_acquire);
+    auto *a = buf_.load(std::memory_order_relaxed);
+    if (b - t > a->capacity() - 1) {
+      a = grow(a, b, t);
+    }
+    a->put(b, x.release());
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+  }
+
+  // owner only
+  pointer pop() noexcept {
+    const auto b = bottom_.load(std::memory_order_relaxed) - 1;
+    auto *a = buf_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto t = top_.load(std::memory_order_relaxed);
+
+    T *x = nullptr;
+    if (t <= b) {
+      x = a->get(b);
+      if (t == b) {
+        // last element, race against stealers
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed))
+          x = nullptr;
+        bottom_.store(b + 1, std::memory_order_relaxed);
+      }
+    } else {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return pointer(x);
+  }
+
+  // any thread, returns nullptr if empty or lost the race
+  pointer steal() noexcept {
+    auto t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const auto b = bottom_.load(std::memory_order_acquire);
+
+    if (t < b) {
+      auto *a = buf_.load(std::memory_order_acquire);
+      T *x = a->get(t);
+      if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                        std::memory_order_relaxed))
+        return nullptr;
+      return pointer(x);
+    }
+    return nullptr;
+  }
+
+  // approximate, may be stale when called from non owner
+  [[nodiscard]] std::size_t size() const noexcept {
+    const auto b = bottom_.load(std::memory_order_relaxed);
+    const auto t = top_.load(std::memory_order_relaxed);
+    return b > t ? static_cast<std::size_t>(b - t) : 0u;
+  }
+
+  [[nodiscard]] bool empty() const noexcept { return size() == 0u; }
+
+  ~chase_lev_deque() {
+    while (pop());
+  }
+
+private:
+  struct ring {
+    explicit ring(std::int64_t cap)
+        : mask_{cap - 1}, slots_{std::make_unique<std::atomic<T *>[]>(cap)} {}
+
+    std::int64_t capacity() const noexcept { return mask_ + 1; }
+
+    T *get(std::int64_t i) const noexcept {
+      return slots_[i & mask_].load(std::memory_order_relaxed);
+    }
+
+    void put(std::int64_t i, T *x) noexcept {
+      slots_[i & mask_].store(x, std::memory_order_relaxed);
+    }
+
+    std::int64_t mask_;
+    std::unique_ptr<std::atomic<T *>[]> slots_;
+  };
+
+  ring *grow(ring *old, std::int64_t b, std::int64_t t) {
+    auto bigger = std::make_unique<ring>(2 * old->capacity());
+    for (auto i = t; i < b; ++i)
+      bigger->put(i, old->get(i));
+
+    auto *a = bigger.get();
+    // stealers may still read from old buffer, keep it alive
+    retired_.emplace_back(std::move(bigger));
+    buf_.store(a, std::memory_order_release);
+    return a;
+  }
+
+  alignas(hardware_destructive_interference_size) std::atomic<std::int64_t> top_;
+  alignas(hardware_destructive_interference_size) std::atomic<std::int64_t> bottom_;
+  alignas(hardware_destructive_interference_size) std::atomic<ring *> buf_;
+  std::vector<std::unique_ptr<ring>> retired_;
+};
+
+} // namespace ds
+} // namespace thp
+
+#endif // CHASE_LEV_DEQUE_HPP_
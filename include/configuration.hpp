@@ -89,8 +89,15 @@ namespace configs {
   constexpr inline decltype(auto) stats_collection_period()  { return std::chrono::milliseconds(1000); }
   constexpr inline decltype(auto) schedule_request_timeout() { return std::chrono::milliseconds(10);   }
   constexpr inline decltype(auto) scheduler_tick()           { return std::chrono::microseconds(10);   }
+  constexpr inline decltype(auto) park_spin_limit()          { return std::chrono::microseconds(50);   }
+  constexpr inline decltype(auto) help_park_limit()          { return std::chrono::microseconds(200);  }
+  constexpr inline decltype(auto) elastic_tick()             { return std::chrono::milliseconds(5);    }
+  constexpr inline decltype(auto) timer_tick()               { return std::chrono::milliseconds(1);    }
+  constexpr inline decltype(auto) fair_share_slice()         { return std::chrono::microseconds(500);  }
   constexpr inline decltype(auto) per_queue_capacity()       { return 16*1024;                         }
   constexpr inline decltype(auto) queue_table_capacity()     { return 1024;                            }
+  constexpr inline decltype(auto) task_storage_size()        { return 64u;                             }
+  constexpr inline decltype(auto) multiqueue_factor()        { return 2u;                              }
   constexpr inline decltype(auto) stl_sort_cutoff()          { return 32*32*1024u;                   }
             inline decltype(auto) hardware_concurrency()     { return std::thread::hardware_concurrency(); }
 } // namespace configs
@@ -2,10 +2,14 @@
 #define CORO_TASK_HPP__
 
 #include <coroutine>
+#include <exception>
 #include <utility>
 #include <iostream>
 #include <future>
+#include <variant>
 
+#include "include/executor.hpp"
+#include "include/future.hpp"
 #include "include/util.hpp"
 
 // TODO: introduce concepts for coroutine related function and promise data structure
@@ -128,6 +132,153 @@ private:
     handle coro;
 };
 
+// co_await resume_on(ex) moves the rest of the coroutine to ex, the handle is
+// queued like any other task and no thread waits for it
+struct resume_on {
+    explicit resume_on(executor& ex) noexcept : ex_{ex} {}
+
+    constexpr bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) { ex_.execute(simple_task{[h] { h.resume(); }}); }
+    constexpr void await_resume() const noexcept {}
+
+private:
+    executor& ex_;
+};
+
+template<typename T>
+struct pool_task;
+
+namespace detail {
+
+template<typename T>
+struct pool_result {
+    template<std::convertible_to<T> From>
+    void return_value(From&& v) { result.template emplace<1>(FWD(v)); }
+
+    T take() {
+        if (result.index() == 2) std::rethrow_exception(std::get<2>(result));
+        return std::move(std::get<1>(result));
+    }
+
+    std::variant<std::monostate, T, std::exception_ptr> result;
+};
+
+template<>
+struct pool_result<void> {
+    void return_void() noexcept {}
+
+    void take() {
+        if (result.index() == 2) std::rethrow_exception(std::get<2>(result));
+    }
+
+    std::variant<std::monostate, std::monostate, std::exception_ptr> result;
+};
+
+template<typename T>
+struct pool_promise : pool_result<T> {
+    pool_task<T> get_return_object() noexcept;
+
+    constexpr std::suspend_always initial_suspend() noexcept { return {}; }
+
+    // hands the thread to the awaiting coroutine, if any
+    struct final_awaiter {
+        constexpr bool await_ready() noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<pool_promise> h) noexcept {
+            return h.promise().continuation;
+        }
+        constexpr void await_resume() noexcept {}
+    };
+    final_awaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() noexcept { this->result.template emplace<2>(std::current_exception()); }
+
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+};
+
+// fire and forget coroutine, frame frees itself at the end
+struct detached {
+    struct promise_type {
+        detached get_return_object() noexcept { return {}; }
+        constexpr std::suspend_never initial_suspend() noexcept { return {}; }
+        constexpr std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+} // namespace detail
+
+// lazy coroutine meant to live on a threadpool. starts when awaited (on the
+// awaiting thread, by symmetric transfer) or when spawned on an executor,
+// inside it co_await tp.schedule() or co_await on a thp::future suspends
+// without holding a worker and resumes on a pool worker.
+//   coro::pool_task<int> handler(threadpool& tp) {
+//     co_await tp.schedule();
+//     co_return co_await tp.submit(work);
+//   }
+//   auto fut = tp.spawn(handler(tp));
+template<typename T>
+struct [[nodiscard]] pool_task {
+    using promise_type = detail::pool_promise<T>;
+    using handle = std::coroutine_handle<promise_type>;
+
+    explicit pool_task(handle h) noexcept : coro{h} {}
+    pool_task(pool_task&& rhs) noexcept : coro{std::exchange(rhs.coro, nullptr)} {}
+    pool_task& operator=(pool_task&&) = delete;
+    ~pool_task() { if (coro) coro.destroy(); }
+
+    auto operator co_await() && noexcept {
+        struct awaiter {
+            constexpr bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> h) noexcept {
+                coro.promise().continuation = h;
+                return coro;
+            }
+            T await_resume() { return coro.promise().take(); }
+
+            handle coro;
+        };
+        return awaiter{coro};
+    }
+
+private:
+    handle coro;
+};
+
+template<typename T>
+pool_task<T> detail::pool_promise<T>::get_return_object() noexcept {
+    return pool_task<T>{std::coroutine_handle<pool_promise>::from_promise(*this)};
+}
+
+namespace detail {
+
+template<typename T>
+detached spawn(executor& ex, pool_task<T> t, promise<T> p) {
+    co_await resume_on(ex);
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await std::move(t);
+            p.set_value();
+        } else {
+            p.set_value(co_await std::move(t));
+        }
+    } catch (...) {
+        p.set_exception(std::current_exception());
+    }
+}
+
+} // namespace detail
+
+// starts t on ex, result or exception of t goes to the future
+template<typename T>
+future<T> spawn(executor& ex, pool_task<T> t) {
+    promise<T> p;
+    auto fut = p.get_future();
+    fut.via(&ex);
+    detail::spawn(ex, std::move(t), std::move(p));
+    return fut;
+}
+
 } // namespace coro
 } // namespace thp
 
@@ -0,0 +1,63 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef EXECUTOR_HPP_
+#define EXECUTOR_HPP_
+
+#include <utility>
+
+#include "include/task_type.hpp"
+
+namespace thp {
+
+// anything that can run a task later, e.g. threadpool.
+// futures use it to run continuations without blocking a thread
+struct executor {
+  virtual void execute(simple_task &&t) = 0;
+  virtual ~executor() = default;
+};
+
+// installed on pool threads while they run. a blocking wait called on a
+// worker (future::wait, task_graph::wait) helps through it: the worker keeps
+// running queued tasks of its pool instead of blocking, so nested
+// parallelism neither starves the queue nor deadlocks a small pool
+struct worker_context {
+  using done_fn = bool (*)(const void *);
+
+  // runs tasks of the pool on this thread till done(arg) is true
+  virtual void help(done_fn done, const void *arg) noexcept = 0;
+  virtual ~worker_context() = default;
+
+  // context of calling thread, nullptr if it is not a pool worker
+  static worker_context *current() noexcept { return current_; }
+
+  // sets the context of calling thread for its lifetime
+  struct scope {
+    explicit scope(worker_context &ctx) noexcept : prev_{std::exchange(current_, &ctx)} {}
+    ~scope() { current_ = prev_; }
+    scope(const scope &) = delete;
+    scope &operator=(const scope &) = delete;
+
+  private:
+    worker_context *prev_;
+  };
+
+private:
+  static inline thread_local worker_context *current_ = nullptr;
+};
+
+} // namespace thp
+
+#endif // EXECUTOR_HPP_
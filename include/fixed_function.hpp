@@ -0,0 +1,128 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef FIXED_FUNCTION_HPP_
+#define FIXED_FUNCTION_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace thp {
+
+template <typename Signature, std::size_t Size = 64>
+class fixed_function;
+
+// move only function object of Size bytes. callables that fit the inline
+// buffer (Size minus one pointer) and are nothrow movable are stored in
+// place, bigger ones fall back to the heap.
+template <typename R, typename... Args, std::size_t Size>
+class fixed_function<R(Args...), Size> {
+  struct vtable {
+    R (*invoke)(void *, Args &&...);
+    void (*move)(void *dst, void *src) noexcept;
+    void (*destroy)(void *) noexcept;
+  };
+
+public:
+  static constexpr std::size_t BufferSize = Size - sizeof(const vtable *);
+
+  template <typename F>
+  static constexpr bool fits_inline = sizeof(F) <= BufferSize &&
+                                      alignof(F) <= alignof(std::max_align_t) &&
+                                      std::is_nothrow_move_constructible_v<F>;
+
+  fixed_function() noexcept : vt_{nullptr} {}
+
+  template <typename F, typename D = std::decay_t<F>>
+    requires(!std::is_same_v<D, fixed_function>) && std::is_invocable_r_v<R, D &, Args...>
+  fixed_function(F &&f) : vt_{nullptr} { // NOLINT: implicit like std::function
+    if constexpr (fits_inline<D>) {
+      ::new (static_cast<void *>(buf_)) D(std::forward<F>(f));
+      vt_ = &inline_vt<D>;
+    } else {
+      ::new (static_cast<void *>(buf_)) D *(new D(std::forward<F>(f)));
+      vt_ = &heap_vt<D>;
+    }
+  }
+
+  fixed_function(fixed_function &&rhs) noexcept : vt_{rhs.vt_} {
+    if (vt_) {
+      vt_->move(buf_, rhs.buf_);
+      rhs.vt_ = nullptr;
+    }
+  }
+
+  fixed_function &operator=(fixed_function &&rhs) noexcept {
+    if (this != &rhs) {
+      reset();
+      if ((vt_ = rhs.vt_)) {
+        vt_->move(buf_, rhs.buf_);
+        rhs.vt_ = nullptr;
+      }
+    }
+    return *this;
+  }
+
+  fixed_function(const fixed_function &) = delete;
+  fixed_function &operator=(const fixed_function &) = delete;
+
+  ~fixed_function() { reset(); }
+
+  R operator()(Args... args) {
+    return vt_->invoke(buf_, std::forward<Args>(args)...);
+  }
+
+  explicit operator bool() const noexcept { return vt_ != nullptr; }
+
+private:
+  void reset() noexcept {
+    if (vt_) {
+      vt_->destroy(buf_);
+      vt_ = nullptr;
+    }
+  }
+
+  template <typename D>
+  static D *as(void *p) noexcept { return std::launder(static_cast<D *>(p)); }
+
+  template <typename D>
+  static constexpr vtable inline_vt{
+      [](void *p, Args &&...args) -> R {
+        return std::invoke(*as<D>(p), std::forward<Args>(args)...);
+      },
+      [](void *dst, void *src) noexcept {
+        ::new (dst) D(std::move(*as<D>(src)));
+        as<D>(src)->~D();
+      },
+      [](void *p) noexcept { as<D>(p)->~D(); }};
+
+  template <typename D>
+  static constexpr vtable heap_vt{
+      [](void *p, Args &&...args) -> R {
+        return std::invoke(**as<D *>(p), std::forward<Args>(args)...);
+      },
+      [](void *dst, void *src) noexcept { ::new (dst) D *(*as<D *>(src)); },
+      [](void *p) noexcept { delete *as<D *>(p); }};
+
+  alignas(std::max_align_t) std::byte buf_[BufferSize];
+  const vtable *vt_;
+};
+
+} // namespace thp
+
+#endif // FIXED_FUNCTION_HPP_
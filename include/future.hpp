@@ -0,0 +1,351 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef FUTURE_HPP_
+#define FUTURE_HPP_
+
+#include <atomic>
+#include <cassert>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <functional>
+#include <future>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "include/executor.hpp"
+#include "include/slab_allocator.hpp"
+#include "include/task_type.hpp"
+
+namespace thp {
+
+template <typename T> struct future;
+template <typename T> struct promise;
+
+namespace detail {
+
+// result slot shared by one promise and one future, lives in a slab block
+// and goes back to it when both sides are gone
+template <typename T>
+struct shared_state {
+  using value_type = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+  enum : std::uint32_t { ePending = 0, eReady = 1, eChained = 2 };
+
+  template <typename... Args>
+  void set_value(Args &&...args) {
+    result_.template emplace<1>(std::forward<Args>(args)...);
+    publish();
+  }
+
+  void set_exception(std::exception_ptr e) noexcept {
+    result_.template emplace<2>(std::move(e));
+    publish();
+  }
+
+  bool ready() const noexcept {
+    return status_.load(std::memory_order_acquire) == eReady;
+  }
+
+  // on a pool worker runs other tasks of the pool meanwhile
+  void wait() const noexcept {
+    if (auto *ctx = worker_context::current(); ctx && !ready())
+      ctx->help([](const void *s) { return static_cast<const shared_state *>(s)->ready(); },
+                this);
+    for (auto st = status_.load(std::memory_order_acquire); st != eReady;
+         st = status_.load(std::memory_order_acquire))
+      status_.wait(st, std::memory_order_acquire);
+  }
+
+  // runs t once the result is set, on ex or else on the thread setting it.
+  // one continuation per state, see drop_on_ready()
+  void on_ready(executor *ex, simple_task &&t) noexcept {
+    assert(status_.load(std::memory_order_relaxed) != eChained && "future has a continuation");
+    cont_ex_ = ex;
+    cont_.emplace(std::move(t));
+    auto expected = std::uint32_t{ePending};
+    if (!status_.compare_exchange_strong(expected, eChained, std::memory_order_acq_rel,
+                                         std::memory_order_acquire))
+      dispatch(); // already ready
+  }
+
+  // takes back the continuation if it didn't run, false if it runs or ran
+  // already. the caller makes sure no on_ready() races with it
+  bool drop_on_ready() noexcept {
+    auto expected = std::uint32_t{eChained};
+    if (!status_.compare_exchange_strong(expected, ePending, std::memory_order_acq_rel,
+                                         std::memory_order_acquire))
+      return false;
+    cont_.reset();
+    cont_ex_ = nullptr;
+    return true;
+  }
+
+  value_type take() {
+    wait();
+    if (result_.index() == 2)
+      std::rethrow_exception(std::get<2>(result_));
+    return std::move(std::get<1>(result_));
+  }
+
+  void acquire() noexcept { refs_.fetch_add(1, std::memory_order_relaxed); }
+
+  void release() noexcept {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      ds::slab_delete<shared_state>{}(this);
+  }
+
+private:
+  void publish() noexcept {
+    const auto old = status_.exchange(eReady, std::memory_order_acq_rel);
+    status_.notify_all();
+    if (old == eChained)
+      dispatch();
+  }
+
+  void dispatch() noexcept {
+    auto t = std::move(cont_.value());
+    cont_.reset();
+    if (cont_ex_)
+      cont_ex_->execute(std::move(t));
+    else
+      t.execute();
+  }
+
+  std::atomic<std::uint32_t> status_{ePending};
+  std::atomic<std::uint32_t> refs_{1};
+  std::variant<std::monostate, value_type, std::exception_ptr> result_;
+  executor *cont_ex_ = nullptr;
+  std::optional<simple_task> cont_;
+};
+
+template <typename T>
+struct state_ref {
+  state_ref() noexcept = default;
+  explicit state_ref(shared_state<T> *s) noexcept : s_{s} {}
+  state_ref(state_ref &&rhs) noexcept : s_{std::exchange(rhs.s_, nullptr)} {}
+  state_ref &operator=(state_ref &&rhs) noexcept {
+    if (this != &rhs) {
+      reset();
+      s_ = std::exchange(rhs.s_, nullptr);
+    }
+    return *this;
+  }
+  ~state_ref() { reset(); }
+
+  void reset() noexcept {
+    if (auto *s = std::exchange(s_, nullptr))
+      s->release();
+  }
+
+  state_ref share() const noexcept {
+    s_->acquire();
+    return state_ref{s_};
+  }
+
+  shared_state<T> *get() const noexcept { return s_; }
+  shared_state<T> *operator->() const noexcept { return s_; }
+  explicit operator bool() const noexcept { return s_ != nullptr; }
+
+private:
+  shared_state<T> *s_ = nullptr;
+};
+
+// what a continuation gets: the ready future if it asks for one,
+// otherwise the value (nothing for void)
+template <typename Fn, typename T>
+struct continuation_result {
+  using type = std::invoke_result_t<Fn &, T>;
+};
+
+template <typename Fn>
+struct continuation_result<Fn, void> {
+  using type = std::invoke_result_t<Fn &>;
+};
+
+} // namespace detail
+
+// result of a pool task, same blocking interface as std::future but the
+// shared state is taken from the slab allocator and recycled.
+// then() chains work without blocking, continuation runs on the executor
+// the future is bound to (the pool for futures from threadpool::submit)
+template <typename T>
+struct future {
+  future() noexcept = default;
+  future(future &&) noexcept = default;
+  future &operator=(future &&) noexcept = default;
+
+  [[nodiscard]] bool valid() const noexcept { return static_cast<bool>(st_); }
+  [[nodiscard]] bool ready() const noexcept { return st_->ready(); }
+
+  void wait() const noexcept { st_->wait(); }
+
+  // continuations of this future run on ex
+  future &via(executor *ex) noexcept {
+    ex_ = ex;
+    return *this;
+  }
+
+  executor *get_executor() const noexcept { return ex_; }
+
+  // fn(value), fn() for void, or fn(future<T>) to see exceptions. the value
+  // is preferred when fn takes either, e.g. a generic lambda.
+  // invalidates this future, if it failed fn is skipped (unless it takes
+  // the future) and returned future carries the exception
+  template <typename Fn>
+  auto then(Fn &&fn) {
+    return then(ex_, std::forward<Fn>(fn));
+  }
+
+  template <typename Fn>
+  auto then(executor *ex, Fn &&fn) {
+    constexpr bool takes_value = [] {
+      if constexpr (std::is_void_v<T>)
+        return std::invocable<std::decay_t<Fn> &>;
+      else
+        return std::invocable<std::decay_t<Fn> &, T>;
+    }();
+    // checked only without a value overload, the check instantiates fn
+    constexpr bool takes_future = [] {
+      if constexpr (takes_value)
+        return false;
+      else
+        return std::invocable<std::decay_t<Fn> &, future<T>>;
+    }();
+    using Arg = std::conditional_t<takes_future, future<T>, T>;
+    using U = typename detail::continuation_result<std::decay_t<Fn>, Arg>::type;
+
+    promise<U> p;
+    auto next = p.get_future();
+    next.via(ex);
+
+    auto *st = st_.get();
+    st->on_ready(ex, simple_task{[ref = std::move(st_), ex, p = std::move(p),
+                                  fn = std::forward<Fn>(fn)]() mutable {
+      if constexpr (takes_future)
+        p.run([&] { return std::invoke(fn, future<T>{std::move(ref), ex}); });
+      else if constexpr (std::is_void_v<T>)
+        p.run([&] { ref->take(); return std::invoke(fn); });
+      else
+        p.run([&] { return std::invoke(fn, ref->take()); });
+    }});
+    return next;
+  }
+
+  // t runs on the thread setting the result, or right here if it is set
+  // already, the future stays valid. uses the one continuation slot, so
+  // then() is allowed only after the future is ready
+  void on_ready(simple_task &&t) noexcept { st_->on_ready(nullptr, std::move(t)); }
+
+  // removes the task of on_ready() unless it runs or ran, the future can
+  // be chained again afterwards
+  bool drop_on_ready() noexcept { return st_->drop_on_ready(); }
+
+  // co_await std::move(fut) suspends the coroutine till the result is set
+  // and resumes it on the future's executor, no thread waits in between
+  auto operator co_await() && noexcept {
+    struct awaiter {
+      bool await_ready() const noexcept { return f.ready(); }
+      void await_suspend(std::coroutine_handle<> h) noexcept {
+        f.st_->on_ready(f.ex_, simple_task{[h] { h.resume(); }});
+      }
+      T await_resume() { return f.get(); }
+
+      future f;
+    };
+    return awaiter{std::move(*this)};
+  }
+
+  // waits for result, invalidates the future
+  T get() {
+    auto st = std::move(st_);
+    if constexpr (std::is_void_v<T>)
+      st->take();
+    else
+      return st->take();
+  }
+
+private:
+  friend struct promise<T>;
+  explicit future(detail::state_ref<T> st, executor *ex = nullptr) noexcept
+      : st_{std::move(st)}, ex_{ex} {}
+
+  detail::state_ref<T> st_;
+  executor *ex_ = nullptr;
+};
+
+template <typename T>
+struct promise {
+  promise() : st_{ds::make_slab<detail::shared_state<T>>().release()} {}
+  promise(promise &&) noexcept = default;
+  promise &operator=(promise &&rhs) noexcept {
+    if (this != &rhs) {
+      abandon();
+      st_ = std::move(rhs.st_);
+      retrieved_ = rhs.retrieved_;
+    }
+    return *this;
+  }
+
+  ~promise() { abandon(); }
+
+  // only once
+  future<T> get_future() {
+    if (retrieved_)
+      throw std::future_error(std::future_errc::future_already_retrieved);
+    retrieved_ = true;
+    return future<T>{st_.share()};
+  }
+
+  template <typename... Args>
+  void set_value(Args &&...args) {
+    st_->set_value(std::forward<Args>(args)...);
+  }
+
+  void set_exception(std::exception_ptr e) noexcept {
+    st_->set_exception(std::move(e));
+  }
+
+  // runs fn, stores its result or the exception it throws
+  template <typename Fn>
+  void run(Fn &&fn) noexcept {
+    try {
+      if constexpr (std::is_void_v<T>) {
+        std::invoke(std::forward<Fn>(fn));
+        set_value();
+      } else {
+        set_value(std::invoke(std::forward<Fn>(fn)));
+      }
+    } catch (...) {
+      set_exception(std::current_exception());
+    }
+  }
+
+private:
+  // never fulfilled, waiting side gets broken_promise
+  void abandon() noexcept {
+    if (st_ && !st_->ready())
+      st_->set_exception(std::make_exception_ptr(
+          std::future_error(std::future_errc::broken_promise)));
+  }
+
+  detail::state_ref<T> st_;
+  bool retrieved_ = false;
+};
+
+} // namespace thp
+
+#endif // FUTURE_HPP_
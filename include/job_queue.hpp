@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef JOB_QUEUE_HPP_
 #define JOB_QUEUE_HPP_
 
+#include <iterator>
 #include <variant>
 #include <numeric>
 #include <vector>
@@ -25,10 +26,12 @@ limitations under the License.
 #include "include/task_queue.hpp"
 #include "include/task_type.hpp"
 #include "include/statistics.hpp"
+#include "include/tenant_queue.hpp"
 #include "include/util.hpp"
 #include "include/all_priority_types.hpp"
 #include "include/managed_stop_token.hpp"
 #include "include/algos/queue_selection/custom.hpp"
+#include "include/algos/queue_selection/fair_share.hpp"
 #include "include/algos/queue_selection/maxlen.hpp"
 
 namespace thp {
@@ -49,7 +52,8 @@ struct job_queue {
   static const auto NumQs = std::tuple_size_v<TaskQueueTupleType>;
 
   constexpr explicit job_queue()
-  : task_qs_{create_taskqs_tuple(std::make_index_sequence<NumQs>{})}
+  : task_qs_{}
+  , tenant_qs_{}
   , all_qs_{}
   , algo_{std::make_unique<algos::queue_select::custom_algo>()}
   , bestq_{nullptr}
@@ -60,12 +64,91 @@ struct job_queue {
   constexpr job_queue<TaskQueueTupleType>& schedule_task(kncpt::ThreadPoolTask auto&& t) {
     using ThisTaskType = traits::FindTaskType<decltype(t)>::type;
 
-    taskq_for<ThisTaskType>().push(FWD(t));
+    if constexpr (rng::input_range<decltype(t)>)
+      taskq_for<ThisTaskType>().insert(std::make_move_iterator(rng::begin(t)),
+                                       std::make_move_iterator(rng::end(t)));
+    else
+      taskq_for<ThisTaskType>().push(FWD(t));
     return *this;
   }
 
+  template <typename TaskType>
+  constexpr task_queue* queue_for() noexcept {
+    return std::addressof(taskq_for<TaskType>());
+  }
+
+  // queue of TaskType itself, e.g. for statistics of its own
+  template <typename TaskType>
+  constexpr auto &typed_queue_for() noexcept {
+    return taskq_for<TaskType>();
+  }
+
+  template <typename TaskType>
+  constexpr const auto &typed_queue_for() const noexcept {
+    return std::get<TaskQueueFor_t<typename TaskType::PriorityType>>(task_qs_);
+  }
+
+  // weighted fair share across task queues instead of serving the longest
+  // one, weights in order of the queues (see AllPriority, then tenants),
+  // missing ones are 1.
+  // workers give a queue back after one time slice. set before any worker runs
+  void fair_share(std::vector<unsigned> weights,
+                  std::chrono::nanoseconds slice = configs::fair_share_slice()) {
+    weights.resize(all_qs_.size(), 1);
+    weights_ = weights;
+    algo_ = std::make_unique<algos::queue_select::fairshare_algo>(std::move(weights));
+    for (auto q : all_qs_)
+      q->time_slice(slice);
+  }
+
+  // weights of fair_share(), one per queue, empty without fair share
+  const std::vector<unsigned> &weights() const noexcept { return weights_; }
+
+  // share of worker time each queue got so far, in order of the queues
+  std::vector<double> busy_shares() const {
+    std::vector<double> shares;
+    double total = 0;
+    for (auto q : all_qs_)
+      total += static_cast<double>(q->busy_time().count());
+    for (auto q : all_qs_)
+      shares.push_back(total > 0 ? static_cast<double>(q->busy_time().count()) / total : 0.0);
+    return shares;
+  }
+
+  // bounds every queue to c tasks, 0 for no bound
+  void capacity(std::size_t c) noexcept {
+    for (auto q : all_qs_)
+      q->capacity(c);
+  }
+
+  // backpressure counters of every queue, in order of the queues
+  std::vector<queue_stats> overflow_stats() const {
+    std::vector<queue_stats> st;
+    for (auto q : all_qs_)
+      st.push_back({q->depth(), q->capacity(), q->rejected(), q->blocked()});
+    return st;
+  }
+
+  // a queue per tenant after the typed queues, before init_stats()
+  void add_tenants(const std::vector<tenant_options> &tenants) {
+    for (auto &&t : tenants) {
+      tenant_qs_.emplace_back(std::make_unique<tenant_taskq>(t));
+      all_qs_.push_back(tenant_qs_.back().get());
+    }
+  }
+
+  [[nodiscard]] std::size_t tenants() const noexcept { return tenant_qs_.size(); }
+
+  // throws std::out_of_range for an unknown tenant
+  tenant_taskq &tenant(tenant_id t) { return *tenant_qs_.at(t.id); }
+  const tenant_taskq &tenant(tenant_id t) const { return *tenant_qs_.at(t.id); }
+
   constexpr void close() {}
-  constexpr void stop() {}
+  // drops every queued task, their futures get broken_promise
+  void stop() noexcept {
+    for (auto q : all_qs_)
+      q->clear();
+  }
 
   // returns best queue at the point of request or blocks if empty
   constexpr task_queue* best_queue(statistics& stats) noexcept {
@@ -83,13 +166,8 @@ protected:
     ((all_qs_.push_back(std::addressof(std::get<I>(FWD(tup))))), ...);
   }
 
-  template<std::size_t...I>
-  constexpr TaskQueueTupleType create_taskqs_tuple(std::index_sequence<I...>) {
-    return std::make_tuple(std::tuple_element_t<I, TaskQueueTupleType>()...);
-  }
-
   template <typename TaskType,
-            typename QueueType = priority_taskq<typename TaskType::PriorityType>
+            typename QueueType = TaskQueueFor_t<typename TaskType::PriorityType>
   >
   constexpr inline auto& taskq_for(void) {
     return std::get<QueueType>(task_qs_);
@@ -98,7 +176,9 @@ protected:
 private:
   // task queues for different task types
   TaskQueueTupleType task_qs_;
+  std::vector<std::unique_ptr<tenant_taskq>> tenant_qs_;
   std::vector<task_queue*> all_qs_;
+  std::vector<unsigned> weights_;
   std::unique_ptr<algos::queue_select::queue_selection_algo> algo_;
   alignas(hardware_destructive_interference_size) std::atomic<task_queue*> bestq_;
 };
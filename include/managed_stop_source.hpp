@@ -47,12 +47,18 @@ struct managed_stop_source_impl
     return shared_from_this();
   }
 
-  void request_pause() noexcept {
-    state.store(stop_source_state_t::paused, std::memory_order_release);
+  // running -> paused, a stopped source stays stopped
+  bool request_pause() noexcept {
+    auto expected = stop_source_state_t::running;
+    return state.compare_exchange_strong(expected, stop_source_state_t::paused,
+                                         std::memory_order_acq_rel);
   }
 
-  void request_resume() noexcept {
-    state.store(stop_source_state_t::running, std::memory_order_release);
+  // paused -> running
+  bool request_resume() noexcept {
+    auto expected = stop_source_state_t::paused;
+    return state.compare_exchange_strong(expected, stop_source_state_t::running,
+                                         std::memory_order_acq_rel);
   }
 
   void request_stop() noexcept {
@@ -117,8 +123,9 @@ struct managed_stop_source : std::stop_source {
 
   [[nodiscard]] managed_stop_token get_managed_token() noexcept;
 
-  void request_pause() noexcept { impl->request_pause(); }
-  void request_resume() noexcept { impl->request_resume(); }
+  bool request_pause() noexcept { return impl->request_pause(); }
+  bool request_resume() noexcept { return impl->request_resume(); }
+  stop_source_state_t current_state() const noexcept { return impl->current_state(); }
   bool request_stop() const noexcept {
     bool ret = false;
     if (std::stop_source::request_stop()) {
@@ -45,6 +45,8 @@ struct managed_thread {
   virtual bool request_stop() = 0;
   virtual void request_resume() = 0;
   virtual void request_pause() = 0;
+  // its pool asked workers to park, long loops over tasks should return
+  virtual bool pause_requested() const noexcept = 0;
   virtual void sleep() = 0;
   virtual void wakeup() = 0;
 
@@ -86,7 +88,17 @@ struct thread : thp::managed_thread {
   }
   bool request_stop() override { return stop_src_.request_stop(); }
   void request_resume() override { stop_src_.request_resume(); }
+
+  // joins a thread which returned on its own, the stop source it shares
+  // with other threads is left alone by destruction afterwards
+  void retire() {
+    join();
+    stop_src_ = managed_stop_source{};
+  }
   void request_pause() override { stop_src_.request_pause(); }
+  bool pause_requested() const noexcept override {
+    return stop_src_.current_state() == stop_source_state_t::paused;
+  }
   void sleep() override {}
   void wakeup() override {}
 
@@ -0,0 +1,209 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef MPMC_QUEUE_HPP_
+#define MPMC_QUEUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+
+#include "include/configuration.hpp"
+#include "platform/spinlock.hpp"
+
+namespace thp {
+namespace ds {
+
+// bounded multi producer multi consumer ring (D. Vyukov), every cell carries
+// a sequence number telling producers/consumers whose turn it is.
+// capacity is rounded up to power of 2
+template <typename T>
+struct mpmc_ring {
+  explicit mpmc_ring(std::size_t capacity = configs::per_queue_capacity())
+      : mask_{round_up(capacity) - 1}
+      , cells_{std::make_unique<cell[]>(mask_ + 1)}
+      , enq_{0}, deq_{0}
+  {
+    for (std::size_t i = 0; i <= mask_; ++i)
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  mpmc_ring(const mpmc_ring &) = delete;
+  mpmc_ring &operator=(const mpmc_ring &) = delete;
+
+  // x is moved from only on success
+  bool try_push(T &x) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    auto pos = enq_.load(std::memory_order_relaxed);
+    cell *c = nullptr;
+    while (true) {
+      c = &cells_[pos & mask_];
+      const auto seq = c->seq.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+      if (diff == 0) {
+        if (enq_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        return false; // full
+      } else {
+        pos = enq_.load(std::memory_order_relaxed);
+      }
+    }
+    ::new (c->storage) T(std::move(x));
+    c->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  std::optional<T> try_pop() noexcept(std::is_nothrow_move_constructible_v<T>) {
+    auto pos = deq_.load(std::memory_order_relaxed);
+    cell *c = nullptr;
+    while (true) {
+      c = &cells_[pos & mask_];
+      const auto seq = c->seq.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (deq_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        return std::nullopt; // empty
+      } else {
+        pos = deq_.load(std::memory_order_relaxed);
+      }
+    }
+    auto *p = std::launder(reinterpret_cast<T *>(c->storage));
+    std::optional<T> t{std::move(*p)};
+    p->~T();
+    c->seq.store(pos + mask_ + 1, std::memory_order_release);
+    return t;
+  }
+
+  // approximate under concurrent access
+  [[nodiscard]] std::size_t size() const noexcept {
+    const auto d = deq_.load(std::memory_order_relaxed);
+    const auto e = enq_.load(std::memory_order_relaxed);
+    return e > d ? e - d : 0u;
+  }
+
+  [[nodiscard]] bool empty() const noexcept { return size() == 0u; }
+  [[nodiscard]] std::size_t capacity() const noexcept { return mask_ + 1; }
+
+  ~mpmc_ring() {
+    while (try_pop());
+  }
+
+private:
+  static std::size_t round_up(std::size_t n) noexcept {
+    std::size_t cap = 2;
+    while (cap < n) cap <<= 1;
+    return cap;
+  }
+
+  struct cell {
+    std::atomic<std::size_t> seq;
+    alignas(T) std::byte storage[sizeof(T)];
+  };
+
+  const std::size_t mask_;
+  std::unique_ptr<cell[]> cells_;
+  alignas(hardware_destructive_interference_size) std::atomic<std::size_t> enq_;
+  alignas(hardware_destructive_interference_size) std::atomic<std::size_t> deq_;
+};
+
+// fifo work queue on top of mpmc_ring, same interface as priority_workq.
+// push/pop/empty/size are lock free while the ring has room, a burst beyond
+// capacity spills into a locked deque which is drained after the ring.
+template <typename T>
+struct mpmc_workq {
+  using Prio = typename T::PriorityType;
+  static_assert(std::is_same_v<void, Prio>, "mpmc_workq is fifo only");
+
+  explicit mpmc_workq(std::size_t capacity = configs::per_queue_capacity())
+      : ring_{capacity}, spilled_{0}, mu_{}, overflow_{} {}
+
+  mpmc_workq(const mpmc_workq &) = delete;
+  mpmc_workq &operator=(const mpmc_workq &) = delete;
+
+  auto pop() noexcept -> std::optional<T> {
+    if (auto t = ring_.try_pop())
+      return t;
+
+    std::optional<T> t;
+    if (spilled_.load(std::memory_order_acquire) > 0) {
+      std::unique_lock l(mu_);
+      if (!overflow_.empty()) {
+        t = std::move(overflow_.front());
+        overflow_.pop_front();
+        spilled_.fetch_sub(1, std::memory_order_release);
+      }
+    }
+    return t;
+  }
+
+  mpmc_workq &push(T x) {
+    // keep fifo order while spilled items are pending
+    if (spilled_.load(std::memory_order_acquire) == 0 && ring_.try_push(x))
+      return *this;
+
+    std::unique_lock l(mu_);
+    overflow_.emplace_back(std::move(x));
+    spilled_.fetch_add(1, std::memory_order_release);
+    return *this;
+  }
+
+  template <std::input_iterator I, std::sentinel_for<I> S>
+    requires std::same_as<T, std::iter_value_t<I>>
+  mpmc_workq &insert(I s, S e) {
+    for (; s != e; ++s) {
+      T x = *s;
+      if (spilled_.load(std::memory_order_acquire) == 0 && ring_.try_push(x))
+        continue;
+
+      // ring is full, rest of the batch goes to overflow under one lock
+      std::unique_lock l(mu_);
+      overflow_.emplace_back(std::move(x));
+      std::size_t n = 1;
+      for (++s; s != e; ++s, ++n)
+        overflow_.emplace_back(*s);
+      spilled_.fetch_add(n, std::memory_order_release);
+      break;
+    }
+    return *this;
+  }
+
+  [[nodiscard]] bool empty() const noexcept {
+    return ring_.empty() && spilled_.load(std::memory_order_acquire) == 0;
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept {
+    return ring_.size() + spilled_.load(std::memory_order_acquire);
+  }
+
+  [[nodiscard]] std::size_t capacity() const noexcept { return ring_.capacity(); }
+
+protected:
+  mpmc_ring<T> ring_;
+  alignas(hardware_destructive_interference_size) std::atomic<std::size_t> spilled_;
+  mutable platform::spin_mutex mu_;
+  std::deque<T> overflow_;
+};
+
+} // namespace ds
+} // namespace thp
+
+#endif // MPMC_QUEUE_HPP_
@@ -0,0 +1,180 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef MULTI_QUEUE_HPP_
+#define MULTI_QUEUE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "include/configuration.hpp"
+#include "platform/spinlock.hpp"
+
+namespace thp {
+namespace rng = std::ranges;
+
+namespace ds {
+
+// relaxed concurrent priority queue (MultiQueue, Rihani/Sanders/Dementiev 2015)
+// q = c*N sequential heaps each behind its own lock. push goes to a random
+// heap, pop looks at tops of two random heaps and takes the better one.
+//
+// rank error bound: a pop returns an element whose rank among all queued
+// elements is O(q) in expectation and O(q log q) with high probability,
+// e.g. q = 2*32 heaps on a 32 core box gives expected rank error below ~64.
+// order inside one heap is strict, pop never reports empty while any heap
+// has elements (falls back to a sweep after failed two-choice attempts).
+template <typename T, typename TaskComp,
+          typename KeyComp = std::less<typename T::PriorityType>>
+struct multi_workq {
+  using Prio = typename T::PriorityType;
+  static_assert(std::is_trivially_copyable_v<Prio>,
+                "multi_workq caches heap tops in atomics");
+
+  explicit multi_workq(std::size_t nheaps = configs::multiqueue_factor() *
+                                           configs::hardware_concurrency())
+      : heaps_(std::max<std::size_t>(nheaps, 2u)) {}
+
+  multi_workq(const multi_workq &) = delete;
+  multi_workq &operator=(const multi_workq &) = delete;
+
+  auto pop() noexcept -> std::optional<T> {
+    const auto n = heaps_.size();
+    auto &rnd = random();
+
+    for (std::size_t attempt = 0; attempt < n; ++attempt) {
+      auto &a = heaps_[rnd() % n];
+      auto &b = heaps_[rnd() % n];
+      auto &h = better(a, b) ? a : b;
+      if (h.size.load(std::memory_order_acquire) == 0)
+        continue;
+
+      std::unique_lock l(h.mu, std::try_to_lock);
+      if (l.owns_lock() && !h.tasks.empty())
+        return take(h);
+    }
+
+    // sweep, keeps pop exact when queue is nearly empty
+    for (auto &h : heaps_) {
+      if (h.size.load(std::memory_order_acquire) == 0)
+        continue;
+      std::unique_lock l(h.mu);
+      if (!h.tasks.empty())
+        return take(h);
+    }
+    return std::nullopt;
+  }
+
+  multi_workq &push(T x) {
+    const auto n = heaps_.size();
+    auto &rnd = random();
+
+    for (std::size_t attempt = 0; attempt < n; ++attempt) {
+      auto &h = heaps_[rnd() % n];
+      std::unique_lock l(h.mu, std::try_to_lock);
+      if (l.owns_lock()) {
+        put(h, std::move(x));
+        return *this;
+      }
+    }
+
+    auto &h = heaps_[rnd() % n];
+    std::unique_lock l(h.mu);
+    put(h, std::move(x));
+    return *this;
+  }
+
+  template <std::input_iterator I, std::sentinel_for<I> S>
+    requires std::same_as<T, std::iter_value_t<I>>
+  multi_workq &insert(I s, S e) {
+    for (; s != e; ++s)
+      push(std::move(*s));
+    return *this;
+  }
+
+  [[nodiscard]] bool empty() const noexcept {
+    return rng::all_of(heaps_, [](auto &&h) {
+      return h.size.load(std::memory_order_relaxed) == 0;
+    });
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept {
+    std::size_t n = 0;
+    for (auto &h : heaps_)
+      n += h.size.load(std::memory_order_relaxed);
+    return n;
+  }
+
+  [[nodiscard]] std::size_t num_heaps() const noexcept { return heaps_.size(); }
+
+private:
+  struct alignas(hardware_destructive_interference_size) heap {
+    platform::spin_mutex mu;
+    std::atomic<std::size_t> size{0};
+    std::atomic<Prio> top{};
+    std::vector<T> tasks;
+  };
+
+  // a is better than b, if it has elements and a higher ranked top
+  static bool better(const heap &a, const heap &b) noexcept {
+    if (b.size.load(std::memory_order_relaxed) == 0) return true;
+    if (a.size.load(std::memory_order_relaxed) == 0) return false;
+    return !KeyComp{}(a.top.load(std::memory_order_relaxed),
+                      b.top.load(std::memory_order_relaxed));
+  }
+
+  // with lock held
+  static T take(heap &h) {
+    rng::pop_heap(h.tasks, TaskComp{});
+    T t = std::move(h.tasks.back());
+    h.tasks.pop_back();
+    publish(h);
+    return t;
+  }
+
+  // with lock held
+  static void put(heap &h, T x) {
+    h.tasks.emplace_back(std::move(x));
+    rng::push_heap(h.tasks, TaskComp{});
+    publish(h);
+  }
+
+  static void publish(heap &h) noexcept {
+    if (!h.tasks.empty())
+      h.top.store(h.tasks.front().priority(), std::memory_order_relaxed);
+    h.size.store(h.tasks.size(), std::memory_order_release);
+  }
+
+  static std::minstd_rand &random() noexcept {
+    thread_local std::minstd_rand rnd(
+        std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    return rnd;
+  }
+
+  std::vector<heap> heaps_;
+};
+
+} // namespace ds
+} // namespace thp
+
+#endif // MULTI_QUEUE_HPP_
@@ -0,0 +1,127 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef NUMA_POOL_HPP_
+#define NUMA_POOL_HPP_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "include/threadpool.hpp"
+#include "platform/numa.hpp"
+
+namespace thp {
+
+// preferred node of a task, e.g. tp.submit(thp::on_node{1}, fn, args...)
+struct on_node {
+  unsigned node;
+};
+
+// one threadpool per numa node, each with its own workers, job queue,
+// scheduler and timer thread. workers stay on the cpus of their node,
+// opts.pinning places them within it.
+// a task goes to the preferred node (the caller's node, or the node of an
+// on_node hint) unless all workers there are busy and a remote node has an
+// idle one. a worker which ran out of local work takes queued tasks of the
+// other nodes before it sleeps, so a backlog on one node doesn't leave the
+// others idle.
+class numa_pool {
+public:
+  // opts.max_threads is split over nodes by their cpu count, opts.cpus is
+  // replaced by the cpus of each node. every node gets at least one worker,
+  // with more nodes than opts.max_threads that is one worker per node
+  explicit numa_pool(const pool_options &opts = {},
+                     std::vector<platform::numa_node> topology = platform::numa_topology());
+
+  // stops every node before any is destroyed, their workers steal across
+  ~numa_pool();
+
+  [[nodiscard]] unsigned nodes() const noexcept { return static_cast<unsigned>(pools_.size()); }
+
+  // pool of node index n. tasks submitted to it run there unless a worker
+  // of another node runs out of work first
+  threadpool &node(unsigned n) { return *pools_.at(n); }
+
+  // node index of the cpu calling thread runs on
+  [[nodiscard]] unsigned current_node() const noexcept;
+
+  template <typename Fn, typename... Args>
+    requires std::invocable<Fn, Args...>
+  decltype(auto) submit(Fn &&fn, Args &&...args) {
+    return submit(on_node{current_node()}, FWD(fn), FWD(args)...);
+  }
+
+  template <typename Fn, typename... Args>
+  decltype(auto) submit(on_node hint, Fn &&fn, Args &&...args) {
+    auto &pool = pick(hint.node % nodes());
+    auto fut = pool.submit(FWD(fn), FWD(args)...);
+    share(pool);
+    return fut;
+  }
+
+  template <typename Fn, typename... Args>
+    requires std::invocable<std::decay_t<Fn>, std::decay_t<Args>...>
+  void post(Fn &&fn, Args &&...args) {
+    post(on_node{current_node()}, FWD(fn), FWD(args)...);
+  }
+
+  template <typename Fn, typename... Args>
+  void post(on_node hint, Fn &&fn, Args &&...args) {
+    auto &pool = pick(hint.node % nodes());
+    pool.post(FWD(fn), FWD(args)...);
+    share(pool);
+  }
+
+  void stop();
+  void shutdown();
+
+private:
+  // preferred node while it has an idle worker, else the next node that has
+  // one, else preferred node anyway
+  threadpool &pick(unsigned preferred) noexcept {
+    auto &local = *pools_[preferred];
+    if (local.has_idle_worker())
+      return local;
+    for (unsigned i = 1; i < nodes(); ++i) {
+      auto &remote = *pools_[(preferred + i) % nodes()];
+      if (remote.has_idle_worker())
+        return remote;
+    }
+    return local;
+  }
+
+  // a task just queued on a busy pool is left to an idle worker of another
+  // node, if there is one
+  void share(threadpool &pool) noexcept {
+    if (pool.has_idle_worker())
+      return;
+    for (auto &&p : pools_)
+      if (p.get() != &pool && p->wake_idle_worker())
+        return;
+  }
+
+  // on_idle of node thief's workers, a queue of another node with tasks
+  task_queue *steal(unsigned thief) noexcept;
+
+  std::vector<platform::numa_node> topology_;
+  std::vector<unsigned> cpu_node_; // cpu -> node index
+  std::vector<std::unique_ptr<threadpool>> pools_;
+  std::atomic<unsigned> ready_; // pools_ built so far, 0 once stopping
+};
+
+} // namespace thp
+
+#endif // NUMA_POOL_HPP_
@@ -0,0 +1,80 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef RT_LANE_HPP_
+#define RT_LANE_HPP_
+
+#include <atomic>
+#include <vector>
+
+#include "include/managed_stop_token.hpp"
+#include "include/task_queue.hpp"
+#include "include/task_type.hpp"
+#include "include/worker.hpp"
+#include "include/worker_pool.hpp"
+
+namespace thp {
+
+struct rt_lane_options {
+  unsigned threads = 0;            // no lane if 0
+  int threshold = 0;               // tasks with priority above it use the lane
+  int os_priority = 1;             // SCHED_FIFO priority of lane workers
+  std::vector<unsigned> cpus = {}; // lane workers are confined to these, if any
+};
+
+// few SCHED_FIFO workers serving only urgent priority tasks, in strict
+// priority order. a task is queued and an idle lane worker woken right
+// away, no scheduler thread in between, so bulk load on the pool doesn't
+// delay it. without the privilege for SCHED_FIFO workers still run, with
+// normal policy.
+class rt_lane {
+public:
+  explicit rt_lane(const rt_lane_options &opts);
+  ~rt_lane() { stop(); }
+
+  [[nodiscard]] bool enabled() const noexcept { return pool_.size() > 0; }
+
+  [[nodiscard]] bool accepts(int prio) const noexcept {
+    return enabled() && prio > threshold_;
+  }
+
+  void push(priority_task<int> &&t) {
+    q_.push(std::move(t));
+    if (auto w = pool_.try_free_worker())
+      w->wakeup();
+  }
+
+  // lane workers which got SCHED_FIFO
+  [[nodiscard]] unsigned realtime_workers() const noexcept {
+    return realtime_.load(std::memory_order_relaxed);
+  }
+
+  void pause() noexcept { pool_.pause(); }
+  void resume() noexcept { pool_.resume(); }
+
+  void stop() { pool_.shutdown(); }
+
+private:
+  void work(managed_stop_token st) noexcept;
+
+  priority_taskq<int> q_;
+  worker_pool<worker> pool_;
+  int threshold_;
+  std::atomic<unsigned> realtime_;
+};
+
+} // namespace thp
+
+#endif // RT_LANE_HPP_
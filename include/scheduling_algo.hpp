@@ -16,20 +16,38 @@ limitations under the License.
 #ifndef SCHEDULER_HPP__
 #define SCHEDULER_HPP__
 
+#include <limits>
 #include <variant>
 
 #include "include/traits.hpp"
 #include "include/algos/scheduling/oneshot.hpp"
 #include "include/algos/scheduling/waiting.hpp"
+#include "include/algos/scheduling/work_stealing.hpp"
 
 namespace thp {
 
+namespace algos {
+namespace scheduler {
+
+enum names : uint8_t {
+  eOneshot = 0,
+  eWaiting = 1,
+  eWorkStealing = 2,
+
+  eInvalid = std::numeric_limits<uint8_t>::max()
+};
+
+} // namespace scheduler
+} // namespace algos
+
 namespace sch = algos::scheduler;
 
 struct scheduling_algo {
+    using algo_type = std::variant<sch::oneshot, sch::waiting, sch::work_stealing>;
+
     template<typename...Args>
-    constexpr explicit scheduling_algo(Args&&... args)
-    : active_algo_{std::in_place_type<sch::oneshot>, FWD(args)...} {}
+    constexpr explicit scheduling_algo(sch::names name, Args&&... args)
+    : active_algo_{create(name, FWD(args)...)} {}
 
     template<typename C>
     constexpr scheduling_algo& operator = (C&& t) {
@@ -45,8 +63,48 @@ struct scheduling_algo {
         return std::visit([](auto&& v) { return v.worker_fn_; }, active_algo_);
     }
 
+    // lets algorithm keep a task submitted from one of its own workers,
+    // false if task should go through job queue
+    bool schedule_local(simple_task& t) {
+        return std::visit([&](auto&& v) {
+            if constexpr (requires { v.schedule_local(t); })
+                return v.schedule_local(t);
+            else
+                return false;
+        }, active_algo_);
+    }
+
+    // runs one task on worker idx while it waits on a result, false if
+    // there was nothing to run
+    bool help_one(unsigned idx, worker& me) noexcept {
+        return std::visit([&](auto&& v) noexcept {
+            if constexpr (requires { v.help_one(idx, me); }) {
+                return v.help_one(idx, me);
+            } else {
+                if (me.run_handoff())
+                    return true;
+                for (auto q : v.stats_.jobq.in.qs)
+                    if (q->accept_one(me))
+                        return true;
+                return false;
+            }
+        }, active_algo_);
+    }
+
 protected:
-    std::variant<sch::oneshot, sch::waiting> active_algo_;
+    template<typename...Args>
+    static algo_type create(sch::names name, Args&&... args) {
+        switch (name) {
+        case sch::eWaiting:
+            return algo_type{std::in_place_type<sch::waiting>, FWD(args)...};
+        case sch::eWorkStealing:
+            return algo_type{std::in_place_type<sch::work_stealing>, FWD(args)...};
+        default:
+            return algo_type{std::in_place_type<sch::oneshot>, FWD(args)...};
+        }
+    }
+
+    algo_type active_algo_;
 };
 
 }
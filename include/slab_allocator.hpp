@@ -0,0 +1,258 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef SLAB_ALLOCATOR_HPP_
+#define SLAB_ALLOCATOR_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "include/configuration.hpp"
+
+namespace thp {
+namespace ds {
+
+// fixed size block allocator with a cache per thread.
+// a block remembers the cache it came from. freeing on the owning thread is
+// a push on a plain free list, freeing on another thread collects blocks per
+// owner and hands them back with one CAS per batch. the owner takes all
+// returned blocks at once when its free list runs dry.
+// caches of exited threads are parked and adopted by new threads, so memory
+// is reused but never given back to the system.
+template <std::size_t BlockSize>
+struct slab {
+  static constexpr std::size_t Alignment = alignof(std::max_align_t);
+  static constexpr std::size_t BlocksPerChunk = 64;
+  static constexpr unsigned RemoteBatch = 32;
+
+  static void *allocate() {
+    auto *ts = local();
+    if (ts == nullptr) [[unlikely]]
+      return with_header(::operator new(Stride), nullptr);
+
+    auto *c = ts->c;
+    if (c->free == nullptr)
+      c->free = c->remote.exchange(nullptr, std::memory_order_acquire);
+    if (c->free == nullptr)
+      c->refill();
+
+    auto *n = c->free;
+    c->free = n->next;
+    return n;
+  }
+
+  static void deallocate(void *p) noexcept {
+    auto *h = header_of(p);
+    auto *owner = h->owner;
+    if (owner == nullptr) [[unlikely]] {
+      ::operator delete(h);
+      return;
+    }
+
+    auto *n = static_cast<node *>(p);
+    auto *ts = local();
+    if (ts == nullptr) [[unlikely]] {
+      owner->give_back(n, n);
+    } else if (ts->c == owner) {
+      n->next = owner->free;
+      owner->free = n;
+    } else {
+      ts->batch.add(owner, n);
+    }
+  }
+
+private:
+  struct node {
+    node *next;
+  };
+
+  struct cache;
+
+  struct alignas(Alignment) header {
+    cache *owner;
+  };
+
+  static constexpr std::size_t Stride =
+      sizeof(header) + (BlockSize + Alignment - 1) / Alignment * Alignment;
+
+  struct cache {
+    node *free = nullptr; // owner thread only
+    alignas(hardware_destructive_interference_size) std::atomic<node *> remote{nullptr};
+    std::vector<std::unique_ptr<std::byte[]>> chunks;
+    cache *next_orphan = nullptr;
+
+    void refill() {
+      auto &chunk = chunks.emplace_back(std::make_unique<std::byte[]>(Stride * BlocksPerChunk));
+      for (std::size_t i = BlocksPerChunk; i-- > 0;) {
+        auto *n = static_cast<node *>(with_header(chunk.get() + i * Stride, this));
+        n->next = free;
+        free = n;
+      }
+    }
+
+    // any thread, links [first, last] in front of remote list
+    void give_back(node *first, node *last) noexcept {
+      auto *head = remote.load(std::memory_order_relaxed);
+      do {
+        last->next = head;
+      } while (!remote.compare_exchange_weak(head, first, std::memory_order_release,
+                                             std::memory_order_relaxed));
+    }
+  };
+
+  // blocks freed by this thread which belong to another cache
+  struct remote_batch {
+    cache *owner = nullptr;
+    node *first = nullptr, *last = nullptr;
+    unsigned n = 0;
+
+    void add(cache *c, node *x) noexcept {
+      if (c != owner)
+        flush();
+      owner = c;
+      x->next = first;
+      first = x;
+      if (last == nullptr)
+        last = x;
+      if (++n == RemoteBatch)
+        flush();
+    }
+
+    void flush() noexcept {
+      if (first)
+        owner->give_back(first, last);
+      owner = nullptr;
+      first = last = nullptr;
+      n = 0;
+    }
+  };
+
+  struct thread_state {
+    thread_state() : c{adopt()} {}
+    ~thread_state() {
+      batch.flush();
+      retire(c);
+      alive() = false;
+    }
+
+    cache *c;
+    remote_batch batch;
+  };
+
+  // nullptr once this thread's state is destroyed
+  static thread_state *local() noexcept {
+    if (!alive()) [[unlikely]]
+      return nullptr;
+    thread_local thread_state ts;
+    return &ts;
+  }
+
+  static bool &alive() noexcept {
+    thread_local bool a = true;
+    return a;
+  }
+
+  struct orphanage {
+    std::mutex mu;
+    cache *head = nullptr;
+  };
+
+  static orphanage &orphans() noexcept {
+    static orphanage o;
+    return o;
+  }
+
+  static cache *adopt() {
+    auto &o = orphans();
+    {
+      std::lock_guard l(o.mu);
+      if (auto *c = o.head) {
+        o.head = c->next_orphan;
+        return c;
+      }
+    }
+    return new cache{};
+  }
+
+  static void retire(cache *c) noexcept {
+    auto &o = orphans();
+    std::lock_guard l(o.mu);
+    c->next_orphan = o.head;
+    o.head = c;
+  }
+
+  static void *with_header(void *raw, cache *owner) noexcept {
+    auto *h = ::new (raw) header{owner};
+    return h + 1;
+  }
+
+  static header *header_of(void *p) noexcept {
+    return static_cast<header *>(p) - 1;
+  }
+};
+
+// size class of T, power of two from 32 bytes up to MaxSlabBlock
+inline constexpr std::size_t MaxSlabBlock = 1024;
+
+template <typename T>
+inline constexpr std::size_t slab_class_v = std::bit_ceil(std::max(sizeof(T), std::size_t{32}));
+
+template <typename T>
+inline constexpr bool slab_sized_v = slab_class_v<T> <= MaxSlabBlock &&
+                                     alignof(T) <= alignof(std::max_align_t);
+
+template <typename T>
+struct slab_delete {
+  void operator()(T *p) const noexcept {
+    if constexpr (slab_sized_v<T>) {
+      p->~T();
+      slab<slab_class_v<T>>::deallocate(p);
+    } else {
+      delete p;
+    }
+  }
+};
+
+template <typename T>
+using slab_ptr = std::unique_ptr<T, slab_delete<T>>;
+
+// like make_unique, small objects come from the slab of their size class
+template <typename T, typename... Args>
+slab_ptr<T> make_slab(Args &&...args) {
+  if constexpr (slab_sized_v<T>) {
+    using Slab = slab<slab_class_v<T>>;
+    void *p = Slab::allocate();
+    try {
+      return slab_ptr<T>(::new (p) T(std::forward<Args>(args)...));
+    } catch (...) {
+      Slab::deallocate(p);
+      throw;
+    }
+  } else {
+    return slab_ptr<T>(new T(std::forward<Args>(args)...));
+  }
+}
+
+} // namespace ds
+} // namespace thp
+
+#endif // SLAB_ALLOCATOR_HPP_
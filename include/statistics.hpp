@@ -28,6 +28,23 @@ struct workerpool_stats {
   std::uint16_t num_workers;
 };
 
+// counters of one tenant, see tenant_queue.hpp
+struct tenant_stats {
+  std::uint64_t submitted;
+  std::uint64_t completed;
+  std::uint32_t running;
+  std::uint32_t queued;
+  std::chrono::nanoseconds busy_time; // worker time spent on its tasks
+};
+
+// backpressure of one bounded task queue, see overflow_policy
+struct queue_stats {
+  std::size_t depth;
+  std::size_t capacity; // 0 if unbounded
+  std::uint64_t rejected; // run by the producer or dropped because it was full
+  std::uint64_t blocked;  // producers that waited for room
+};
+
 struct outputs {
   task_queue* cur_output;
 };
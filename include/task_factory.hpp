@@ -18,7 +18,11 @@ limitations under the License.
 
 #include <type_traits>
 #include <functional>
+#include <ranges>
+#include <utility>
+#include <vector>
 
+#include "include/batch_future.hpp"
 #include "include/task_type.hpp"
 #include "include/all_priority_types.hpp"
 #include "include/register_types.hpp"
@@ -42,6 +46,29 @@ template<typename Prio, typename Fn, typename... Args>
   return priority_task<Prio>(std::packaged_task<Ret()>{std::bind_front(FWD(fn), FWD(args)...)});
 }
 
+// one task per element of args, tasks share fn (called as const) and report
+// to a single batch_future instead of one std::future each
+template <typename Fn, std::ranges::input_range R,
+          typename Arg = std::ranges::range_value_t<R>>
+  requires std::regular_invocable<const std::decay_t<Fn>&, Arg>
+[[nodiscard]] inline decltype(auto) make_task(bulk_t, Fn&& fn, R&& args) {
+  using Job = batch_job<std::decay_t<Fn>, Arg>;
+
+  std::vector<Arg> argv;
+  if constexpr (std::ranges::sized_range<R>)
+    argv.reserve(std::ranges::size(args));
+  for (auto&& v : args)
+    argv.emplace_back(FWD(v));
+
+  auto job = std::make_shared<Job>(FWD(fn), std::move(argv));
+  std::vector<simple_task> tasks;
+  tasks.reserve(job->size());
+  for (std::size_t i = 0; i < job->size(); ++i)
+    tasks.emplace_back(typename Job::item{job, i});
+
+  return std::make_pair(std::move(tasks), batch_future<typename Job::Ret>{std::move(job)});
+}
+
 }
 
 #endif // TASK_FACTORY_HPP__
@@ -0,0 +1,180 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TASK_GRAPH_HPP_
+#define TASK_GRAPH_HPP_
+
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "include/executor.hpp"
+#include "include/task_type.hpp"
+
+namespace thp {
+
+// static DAG of tasks, nodes are callables and edges are dependencies.
+//   task_graph g;
+//   auto a = g.emplace(load), b = g.emplace(clean), c = g.emplace(store);
+//   g.precede(a, b); g.precede(b, c);
+//   g.run(tp); g.wait();
+// a node is handed to the executor only when its last predecessor finished,
+// no thread blocks on a dependency. built once, a graph can run again after
+// wait() returns, a run allocates nothing: counters live in the nodes and a
+// node's task fits inline in simple_task.
+// graph must be acyclic and not modified while running.
+class task_graph {
+public:
+  using node_id = std::size_t;
+
+  task_graph() = default;
+  task_graph(const task_graph &) = delete;
+  task_graph &operator=(const task_graph &) = delete;
+
+  ~task_graph() { wait_done(); }
+
+  template <typename Fn>
+    requires std::invocable<std::decay_t<Fn> &>
+  node_id emplace(Fn &&fn) {
+    assert_idle();
+    nodes_.emplace_back(std::forward<Fn>(fn));
+    return nodes_.size() - 1;
+  }
+
+  // after runs once before has finished
+  void precede(node_id before, node_id after) {
+    assert_idle();
+    if (before == after)
+      throw std::invalid_argument("task_graph: node can't depend on itself");
+    nodes_.at(before).successors.push_back(&nodes_.at(after));
+    ++nodes_[after].preds;
+  }
+
+  std::size_t size() const noexcept { return nodes_.size(); }
+
+  // starts a run, nodes without predecessors go to ex right away
+  void run(executor &ex) {
+    assert_idle();
+    if (nodes_.empty())
+      return;
+
+    ex_ = &ex;
+    error_ = nullptr;
+    failed_.clear(std::memory_order_relaxed);
+    for (auto &n : nodes_)
+      n.pending.store(n.preds, std::memory_order_relaxed);
+    idle_.store(false, std::memory_order_relaxed);
+    remaining_.store(nodes_.size(), std::memory_order_release);
+
+    for (auto &n : nodes_)
+      if (n.preds == 0)
+        submit(&n);
+  }
+
+  bool done() const noexcept {
+    return idle_.load(std::memory_order_acquire);
+  }
+
+  // waits for current run, rethrows first exception thrown by a node.
+  // nodes after a failure are skipped but still counted down
+  void wait() {
+    wait_done();
+    if (error_)
+      std::rethrow_exception(std::exchange(error_, nullptr));
+  }
+
+private:
+  struct node {
+    template <typename Fn>
+    explicit node(Fn &&f) : fn{std::forward<Fn>(f)} {}
+
+    task_function fn;
+    std::vector<node *> successors;
+    unsigned preds = 0;
+    std::atomic<unsigned> pending{0};
+  };
+
+  void submit(node *n) {
+    ex_->execute(simple_task{[this, n] { run_node(n); }});
+  }
+
+  // runs n, releases its successors. last successor to become ready runs
+  // here instead of taking a trip through the queue
+  void run_node(node *n) noexcept {
+    while (n) {
+      if (!failed_.test(std::memory_order_relaxed)) {
+        try {
+          n->fn();
+        } catch (...) {
+          if (!failed_.test_and_set(std::memory_order_relaxed))
+            error_ = std::current_exception();
+        }
+      }
+
+      node *next = nullptr;
+      for (auto *s : n->successors) {
+        if (s->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          if (next)
+            submit(next);
+          next = s;
+        }
+      }
+      finish();
+      n = next;
+    }
+  }
+
+  // a waiter may destroy the graph as soon as idle_ is set, so that is the
+  // last thing the run touches
+  void finish() noexcept {
+    if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      remaining_.notify_all();
+      idle_.store(true, std::memory_order_release);
+    }
+  }
+
+  void wait_done() const noexcept {
+    if (auto *ctx = worker_context::current(); ctx && !done())
+      ctx->help([](const void *g) { return static_cast<const task_graph *>(g)->done(); }, this);
+    for (auto r = remaining_.load(std::memory_order_acquire); r != 0;
+         r = remaining_.load(std::memory_order_acquire))
+      remaining_.wait(r, std::memory_order_acquire);
+    // the last node is between its notify and idle_ for a moment at most
+    while (!done())
+      std::this_thread::yield();
+  }
+
+  void assert_idle() const {
+    if (!done())
+      throw std::logic_error("task_graph: graph is running");
+  }
+
+  std::deque<node> nodes_;
+  executor *ex_ = nullptr;
+  std::atomic<std::size_t> remaining_{0};
+  std::atomic<bool> idle_{true};
+  std::atomic_flag failed_;
+  std::exception_ptr error_;
+};
+
+} // namespace thp
+
+#endif // TASK_GRAPH_HPP_
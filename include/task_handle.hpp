@@ -0,0 +1,92 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TASK_HANDLE_HPP_
+#define TASK_HANDLE_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <stop_token>
+#include <utility>
+
+#include "include/future.hpp"
+
+namespace thp {
+
+// result of a task cancelled before it started
+struct task_cancelled final : std::exception {
+  const char* what() const noexcept override { return "task_cancelled"; }
+};
+
+namespace detail {
+
+// shared by a task_handle and its queued task
+struct cancel_state {
+  enum : std::uint8_t { eQueued = 0, eStarted = 1, eCancelled = 2 };
+
+  // task side, false if cancelled before it started
+  bool start() noexcept {
+    auto expected = std::uint8_t{eQueued};
+    return phase.compare_exchange_strong(expected, eStarted, std::memory_order_acq_rel);
+  }
+
+  // handle side, true if the task will not start
+  bool cancel() noexcept {
+    auto expected = std::uint8_t{eQueued};
+    const bool dropped = phase.compare_exchange_strong(expected, eCancelled, std::memory_order_acq_rel);
+    src.request_stop();
+    return dropped;
+  }
+
+  std::atomic<std::uint8_t> phase{eQueued};
+  std::stop_source src;
+};
+
+} // namespace detail
+
+// future of a task that can be cancelled. a cancelled task still in the
+// queue is skipped when a worker takes it, in O(1), and its future gets
+// task_cancelled. a running task sees the request through the
+// std::stop_token it was given, if it takes one
+template <typename T>
+class task_handle {
+public:
+  task_handle() noexcept = default;
+  task_handle(future<T> &&f, std::shared_ptr<detail::cancel_state> c) noexcept
+      : fut_{std::move(f)}, cancel_{std::move(c)} {}
+
+  // true if the task will not start, false if it started or is done
+  bool cancel() noexcept { return cancel_ && cancel_->cancel(); }
+
+  [[nodiscard]] bool valid() const noexcept { return fut_.valid(); }
+  [[nodiscard]] bool ready() const noexcept { return fut_.ready(); }
+  void wait() const noexcept { fut_.wait(); }
+
+  // waits for result, throws task_cancelled if it never ran
+  T get() { return fut_.get(); }
+
+  // future of the task, e.g. to chain then(), the handle can still cancel
+  future<T> get_future() noexcept { return std::move(fut_); }
+
+private:
+  future<T> fut_;
+  std::shared_ptr<detail::cancel_state> cancel_;
+};
+
+} // namespace thp
+
+#endif // TASK_HANDLE_HPP_
@@ -16,9 +16,13 @@ limitations under the License.
 #ifndef TASK_QUEUE_HPP_
 #define TASK_QUEUE_HPP_
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
 #include "include/work_queue.hpp"
 #include "include/concepts.hpp"
-#include "include/work_queue.hpp"
+#include "include/managed_thread.hpp"
 
 namespace thp {
 namespace rng = std::ranges;
@@ -28,22 +32,129 @@ struct task_queue {
   constexpr virtual std::size_t size() const noexcept = 0;
   constexpr virtual bool empty() const noexcept = 0;
   constexpr virtual void accept(managed_thread& ) noexcept = 0;
+  // runs at most one task, returns false if queue was empty
+  constexpr virtual bool accept_one(managed_thread& ) noexcept = 0;
+  // queued tasks a worker could start now, size() unless the queue holds
+  // tasks back
+  virtual std::size_t servable_size() const noexcept { return empty() ? 0 : size(); }
+  // drops queued tasks without running them, returns how many
+  virtual std::size_t clear() noexcept = 0;
+
+  constexpr virtual ~task_queue() = default;
+
+  // worker time spent in accept() and accept_one() so far
+  [[nodiscard]] std::chrono::nanoseconds busy_time() const noexcept {
+    return std::chrono::nanoseconds{busy_.load(std::memory_order_relaxed)};
+  }
+
+  // accept() returns once it ran tasks for this long, zero drains the queue
+  void time_slice(std::chrono::nanoseconds s) noexcept { slice_ = s; }
+
+  // tasks a bounded queue takes, 0 for no bound. the bound is checked by
+  // producers before they push, see overflow_policy, concurrent ones may
+  // go over it by a task each
+  void capacity(std::size_t c) noexcept { capacity_ = c; }
+  [[nodiscard]] std::size_t capacity() const noexcept { return capacity_; }
+
+  // tasks pushed and not taken out yet
+  [[nodiscard]] std::size_t depth() const noexcept { return depth_.load(std::memory_order_relaxed); }
+
+  [[nodiscard]] bool full() const noexcept { return capacity_ && depth() >= capacity_; }
+
+  // blocks while full, a worker taking a task out wakes us
+  void wait_for_room() const noexcept {
+    for (auto d = depth_.load(std::memory_order_acquire); capacity_ && d >= capacity_;
+         d = depth_.load(std::memory_order_acquire))
+      depth_.wait(d, std::memory_order_acquire);
+  }
+
+  // a producer found the queue full, it ran or dropped a task instead of
+  // queuing it, or it had to wait for room
+  void count_rejected() noexcept { rejected_.fetch_add(1, std::memory_order_relaxed); }
+  void count_blocked() noexcept { blocked_.fetch_add(1, std::memory_order_relaxed); }
+
+  [[nodiscard]] std::uint64_t rejected() const noexcept { return rejected_.load(std::memory_order_relaxed); }
+  [[nodiscard]] std::uint64_t blocked() const noexcept { return blocked_.load(std::memory_order_relaxed); }
+
+protected:
+  // runs next() while it finds a task, the time slice lasts and the pool
+  // of me is not pausing, the time is charged to this queue
+  template <typename Next>
+  void serve(const managed_thread &me, Next &&next) noexcept {
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+    auto now = start;
+    while (!me.pause_requested() && next()) {
+      if (slice_ > std::chrono::nanoseconds::zero() && (now = clock::now()) - start >= slice_)
+        break;
+    }
+    if (slice_ == std::chrono::nanoseconds::zero())
+      now = clock::now();
+    busy_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count(),
+                    std::memory_order_relaxed);
+  }
+
+  // runs run() once, its time is charged to this queue if it ran a task
+  template <typename Run>
+  bool serve_one(Run &&run) noexcept {
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+    const bool ran = run();
+    if (ran)
+      busy_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count(),
+                      std::memory_order_relaxed);
+    return ran;
+  }
+
+  // derived queues count every task they push and take out
+  void queued(std::size_t n) noexcept {
+    depth_.fetch_add(static_cast<std::uint32_t>(n), std::memory_order_relaxed);
+  }
+
+  void taken() noexcept {
+    // only a producer waiting on a full queue needs the wakeup
+    if (depth_.fetch_sub(1, std::memory_order_acq_rel) >= capacity_ && capacity_)
+      depth_.notify_all();
+  }
+
+private:
+  std::atomic<std::int64_t> busy_{0};
+  std::chrono::nanoseconds slice_{0};
+  std::size_t capacity_ = 0;
+  std::atomic<std::uint32_t> depth_{0};
+  std::atomic<std::uint64_t> rejected_{0}, blocked_{0};
 };
 
-// priority task queue
-template<typename PriorityType>
+// priority task queue, WorkQueue is the storage backend
+template<typename PriorityType,
+         typename WorkQueue = ds::priority_workq<priority_task<PriorityType>,
+                                                 std::less<priority_task<PriorityType>>>>
 struct priority_taskq : task_queue
 {
   using TaskType = priority_task<PriorityType>;
   using Comp = std::less<TaskType>;
+  using WorkQueueType = WorkQueue;
 
-  void accept(managed_thread& ) noexcept {
-    while(auto t = wq_.pop()) {
+  void accept(managed_thread& me) noexcept override {
+    serve(me, [this] {
+      auto t = take();
+      if (t)
         t.value().execute();
-    }
+      return t.has_value();
+    });
+  }
+
+  bool accept_one(managed_thread& ) noexcept override {
+    return serve_one([this] {
+      auto t = take();
+      if (t)
+        t.value().execute();
+      return t.has_value();
+    });
   }
 
   constexpr priority_taskq& push(TaskType x) {
+    queued(1);
     wq_.push(std::move(x));
     return *this;
   }
@@ -51,22 +162,120 @@ struct priority_taskq : task_queue
   template<std::input_iterator I, std::sentinel_for<I> S>
     requires std::same_as<TaskType, std::iter_value_t<I>>
   constexpr priority_taskq& insert(I s, S e) {
-    wq_.insert(s, e);
+    if constexpr (std::sized_sentinel_for<S, I>) {
+      queued(static_cast<std::size_t>(e - s));
+      wq_.insert(s, e);
+    } else {
+      for (; s != e; ++s)
+        push(*s);
+    }
     return *this;
   }
 
   template<std::ranges::input_range R>
     requires std::movable<R> && std::is_same_v<rng::range_value_t<R>, TaskType>
   constexpr priority_taskq& insert(R&& v) {
-    wq_.insert(std::move(v));
+    if constexpr (rng::sized_range<R>) {
+      queued(rng::size(v));
+      wq_.insert(std::move(v));
+    } else {
+      for (auto &&t : v)
+        push(std::move(t));
+    }
     return *this;
   }
 
+  std::size_t clear() noexcept override {
+    std::size_t n = 0;
+    while (take())
+      ++n;
+    return n;
+  }
+
+  // drops the oldest task of a fifo queue to make room, false if empty
+  bool drop_oldest() noexcept
+    requires std::is_void_v<PriorityType>
+  {
+    return take().has_value();
+  }
+
   constexpr inline bool empty() const noexcept override { return wq_.empty(); }
   constexpr inline size_t size() const noexcept override { return wq_.size(); }
 
 protected:
-  ds::priority_workq<TaskType, Comp> wq_;
+  std::optional<TaskType> take() noexcept {
+    auto t = wq_.pop();
+    if (t)
+      taken();
+    return t;
+  }
+
+  WorkQueue wq_;
+};
+
+using deadline_clock = std::chrono::steady_clock;
+using deadline_task = priority_task<deadline_clock::time_point>;
+
+// what a deadline queue does with a task taken after its deadline
+enum class deadline_policy : std::uint8_t {
+  eRun = 0, // runs it anyway, counted as missed
+  eDrop,    // destroys it unrun, its future gets broken_promise
+};
+
+struct deadline_stats {
+  std::uint64_t met;     // started by their deadline
+  std::uint64_t missed;  // started late
+  std::uint64_t dropped; // past their deadline, not run
+};
+
+// earliest deadline first, the priority of a task is its deadline and
+// workers always take the earliest one. the deadline is checked when a
+// worker takes the task, so a miss means the task started late
+struct deadline_taskq final
+    : priority_taskq<deadline_clock::time_point,
+                     ds::priority_workq<deadline_task, std::greater<deadline_task>>> {
+  void accept(managed_thread &me) noexcept override {
+    serve(me, [this] {
+      auto t = take();
+      if (t)
+        run(t.value());
+      return t.has_value();
+    });
+  }
+
+  bool accept_one(managed_thread &) noexcept override {
+    return serve_one([this] {
+      auto t = take();
+      if (t)
+        run(t.value());
+      return t.has_value();
+    });
+  }
+
+  // set before tasks are queued
+  void on_miss(deadline_policy p) noexcept { policy_ = p; }
+
+  [[nodiscard]] deadline_stats stats() const noexcept {
+    return {met_.load(std::memory_order_relaxed), missed_.load(std::memory_order_relaxed),
+            dropped_.load(std::memory_order_relaxed)};
+  }
+
+private:
+  void run(deadline_task &t) noexcept {
+    if (deadline_clock::now() <= t.priority()) {
+      met_.fetch_add(1, std::memory_order_relaxed);
+    } else if (policy_ == deadline_policy::eDrop) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      missed_.fetch_add(1, std::memory_order_relaxed);
+    }
+    t.execute();
+  }
+
+  deadline_policy policy_ = deadline_policy::eRun;
+  alignas(hardware_destructive_interference_size) std::atomic<std::uint64_t> met_{0};
+  std::atomic<std::uint64_t> missed_{0}, dropped_{0};
 };
 
 } // namespace thp
@@ -16,20 +16,64 @@ limitations under the License.
 #ifndef TASK_TYPE_HPP_
 #define TASK_TYPE_HPP_
 
+#include <atomic>
 #include <compare>
+#include <cstdint>
 #include <execution>
 #include <future>
+#include <utility>
 
 #include "include/configuration.hpp"
 #include "include/executable.hpp"
+#include "include/fixed_function.hpp"
 
 namespace thp {
 
-template <typename P = void> struct priority_task {
+// callable of a task, kept inline unless bigger than a cache line
+using task_function = fixed_function<void(), configs::task_storage_size()>;
+
+namespace detail {
+
+// a task counted in a pool's in-flight tasks, from queueing until it is
+// destroyed, which is right after it ran or when it is dropped
+class task_tracker {
+public:
+  task_tracker() noexcept = default;
+  task_tracker(task_tracker &&rhs) noexcept : count_{std::exchange(rhs.count_, nullptr)} {}
+  task_tracker &operator=(task_tracker &&rhs) noexcept {
+    if (this != &rhs) {
+      release();
+      count_ = std::exchange(rhs.count_, nullptr);
+    }
+    return *this;
+  }
+  ~task_tracker() { release(); }
+
+  // counts the task in c, whoever waits for c to drop to zero is woken
+  void track(std::atomic<std::uint32_t> &c) noexcept {
+    release();
+    c.fetch_add(1, std::memory_order_relaxed);
+    count_ = &c;
+  }
+
+private:
+  void release() noexcept {
+    if (count_ && count_->fetch_sub(1, std::memory_order_acq_rel) == 1)
+      count_->notify_all();
+    count_ = nullptr;
+  }
+
+  std::atomic<std::uint32_t> *count_ = nullptr;
+};
+
+} // namespace detail
+
+template <typename P = void> struct priority_task : detail::task_tracker {
   using PriorityType = P;
 
   template <typename PackagedTask>
-    requires std::regular_invocable<PackagedTask> && std::movable<PackagedTask>
+    requires std::regular_invocable<PackagedTask> && std::is_object_v<PackagedTask> &&
+             std::move_constructible<PackagedTask>
   explicit priority_task(PackagedTask &&pt)
       : prio_{}, pt_([fn = std::move(pt)] mutable { fn(); }) {}
 
@@ -47,14 +91,15 @@ template <typename P = void> struct priority_task {
 
 protected:
   PriorityType prio_;
-  std::move_only_function<void()> pt_;
+  task_function pt_;
 };
 
-template <> struct priority_task<void> {
+template <> struct priority_task<void> : detail::task_tracker {
   using PriorityType = void;
 
   template <typename PackagedTask>
-    requires std::regular_invocable<PackagedTask> && std::movable<PackagedTask>
+    requires std::regular_invocable<PackagedTask> && std::is_object_v<PackagedTask> &&
+             std::move_constructible<PackagedTask>
   explicit priority_task(PackagedTask &&pt)
       : pt_([fn = std::move(pt)] mutable { fn(); }) {}
 
@@ -65,7 +110,7 @@ template <> struct priority_task<void> {
   }
 
 protected:
-  std::move_only_function<void()> pt_;
+  task_function pt_;
 };
 
 using simple_task = priority_task<void>;
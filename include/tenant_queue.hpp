@@ -0,0 +1,138 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENANT_QUEUE_HPP_
+#define TENANT_QUEUE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+#include "include/statistics.hpp"
+#include "include/task_queue.hpp"
+#include "include/task_type.hpp"
+#include "include/work_queue.hpp"
+
+namespace thp {
+
+// tag of tenant tasks, e.g. tp.submit(thp::tenant_id{2}, fn, args...)
+struct tenant_id {
+  unsigned id;
+};
+
+struct tenant_options {
+  unsigned max_concurrency = 0; // tasks of the tenant running at once, 0 for no limit
+  unsigned weight = 1;          // share of workers, relative to other queues
+};
+
+// fifo queue of one tenant. at most max_concurrency of its tasks run at a
+// time, while at the limit the queue reports empty() so queue selection
+// passes it over. a worker leaving it with tasks left calls the ready
+// callback, the scheduler takes it from there.
+class tenant_taskq final : public task_queue {
+public:
+  explicit tenant_taskq(const tenant_options &opts)
+      : max_{opts.max_concurrency}, ready_{}, wq_{}, running_{0}, submitted_{0}, completed_{0} {}
+
+  // called when the queue becomes servable again, set before tasks run
+  void on_ready(std::function<void()> fn) { ready_ = std::move(fn); }
+
+  tenant_taskq &push(simple_task t) {
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    queued(1);
+    wq_.push(std::move(t));
+    return *this;
+  }
+
+  std::size_t size() const noexcept override { return wq_.size(); }
+
+  bool empty() const noexcept override {
+    return wq_.empty() || (max_ && running_.load(std::memory_order_seq_cst) >= max_);
+  }
+
+  // no more than the tasks still allowed to run next to the running ones
+  std::size_t servable_size() const noexcept override {
+    const auto n = wq_.size();
+    if (!max_)
+      return n;
+    const auto running = running_.load(std::memory_order_seq_cst);
+    return running >= max_ ? 0 : std::min<std::size_t>(n, max_ - running);
+  }
+
+  void accept(managed_thread &me) noexcept override {
+    serve(me, [this] { return run_one(); });
+    if (ready_ && !empty())
+      ready_();
+  }
+
+  bool accept_one(managed_thread &) noexcept override {
+    const bool ran = serve_one([this] { return run_one(); });
+    if (ready_ && !empty())
+      ready_();
+    return ran;
+  }
+
+  std::size_t clear() noexcept override {
+    std::size_t n = 0;
+    while (wq_.pop()) {
+      taken();
+      ++n;
+    }
+    return n;
+  }
+
+  // drops the oldest task to make room, false if empty
+  bool drop_oldest() noexcept {
+    if (!wq_.pop())
+      return false;
+    taken();
+    return true;
+  }
+
+  [[nodiscard]] tenant_stats stats() const noexcept {
+    return {submitted_.load(std::memory_order_relaxed), completed_.load(std::memory_order_relaxed),
+            running_.load(std::memory_order_relaxed), static_cast<std::uint32_t>(wq_.size()),
+            busy_time()};
+  }
+
+private:
+  bool run_one() noexcept {
+    if (running_.fetch_add(1, std::memory_order_seq_cst) >= max_ && max_) {
+      running_.fetch_sub(1, std::memory_order_seq_cst);
+      return false;
+    }
+    auto t = wq_.pop();
+    if (t) {
+      taken();
+      t.value().execute();
+      completed_.fetch_add(1, std::memory_order_relaxed);
+    }
+    // a submitter seeing us at the limit relies on this worker seeing its
+    // task afterwards
+    running_.fetch_sub(1, std::memory_order_seq_cst);
+    return t.has_value();
+  }
+
+  unsigned max_;
+  std::function<void()> ready_;
+  ds::priority_workq<simple_task, std::less<simple_task>> wq_;
+  alignas(hardware_destructive_interference_size) std::atomic<std::uint32_t> running_;
+  std::atomic<std::uint64_t> submitted_, completed_;
+};
+
+} // namespace thp
+
+#endif // TENANT_QUEUE_HPP_
@@ -16,28 +16,79 @@ limitations under the License.
 #ifndef THREADPOOL_HPP_
 #define THREADPOOL_HPP_
 
+#include <functional>
+#include <optional>
 #include <ranges>
 #include <thread>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "include/algos/partitioner/equal_size.hpp"
+#include "include/algos/thread_functions/elastic_sizer.hpp"
 #include "include/concepts.hpp"
 #include "include/coroutine/generator.hpp"
+#include "include/coroutine/task.hpp"
+#include "include/executor.hpp"
+#include "include/future.hpp"
 #include "include/managed_stop_source.hpp"
 #include "include/managed_thread.hpp"
 #include "include/partitioner.hpp"
+#include "include/rt_lane.hpp"
 #include "include/scheduling_algo.hpp"
 #include "include/task_factory.hpp"
+#include "include/task_handle.hpp"
 #include "include/task_type.hpp"
+#include "include/timer_wheel.hpp"
 #include "include/util.hpp"
 #include "include/worker_pool.hpp"
+#include "platform/numa.hpp"
 
 namespace thp {
 
-class threadpool final {
+// how submit() gets a task to a worker
+enum class dispatch_mode : uint8_t {
+  eScheduler = 0, // enqueue and wake scheduler thread, which picks a worker
+  eDirect = 1,    // claim an idle worker and wake it, enqueue only if all are busy
+};
+
+// what a producer does when the task queue it pushes to is full
+enum class overflow_policy : uint8_t {
+  eBlock = 0,  // waits for room, a pool worker runs the task itself instead
+  eCallerRuns, // runs the task on the calling thread
+  eDropOldest, // drops the oldest queued task, its future gets broken_promise.
+               // priority and deadline queues drop the new task instead
+};
+
+struct pool_options {
+  unsigned max_threads = std::thread::hardware_concurrency();
+  sch::names algo = sch::eOneshot;
+  dispatch_mode dispatch = dispatch_mode::eScheduler;
+  std::vector<unsigned> cpus = {}; // cpus of the pool, all usable cpus if empty
+  platform::pin_policy pinning = platform::pin_policy::eNone;
+  rt_lane_options rt = {}; // SCHED_FIFO lane for urgent priority tasks, off by default
+  elastic_options elastic = {}; // min_threads below max_threads makes the pool elastic
+  deadline_policy on_deadline_miss = deadline_policy::eRun;
+  // weighted fair share of workers over the fifo, priority and deadline
+  // queues, in that order. empty serves the longest queue
+  std::vector<unsigned> queue_weights = {};
+  // a queue per tenant, tenant_id{i} is tenants[i]. with tenants, workers
+  // are shared by weight between the queues above and the tenants
+  std::vector<tenant_options> tenants = {};
+  // bound of every task queue, 0 for none
+  std::size_t queue_capacity = configs::per_queue_capacity();
+  overflow_policy on_overflow = overflow_policy::eBlock;
+  // asked by a worker which found the queues of its pool empty and went
+  // idle, a queue of another pool it takes a task from or nullptr. see
+  // numa_pool
+  std::function<task_queue *()> on_idle = {};
+};
+
+class threadpool final : public executor {
 public:
-  explicit threadpool(unsigned max_threads = std::thread::hardware_concurrency());
+  explicit threadpool(unsigned max_threads = std::thread::hardware_concurrency(),
+                      sch::names algo = sch::eOneshot);
+  explicit threadpool(const pool_options &opts);
 
   template <typename Fn, std::ranges::input_range R>
   generator<std::invoke_result_t<Fn, rng::range_value_t<R>>>
@@ -54,7 +105,7 @@ public:
     else {
       algos::partitioner::equal_size algo(chunksize, args.begin(), args.end());
       partitioner chunks(algo);
-      std::vector<std::future<generator<Ret>>> futs;
+      std::vector<future<generator<Ret>>> futs;
 
       if constexpr (rng::sized_range<R> && requires { typename R::size; })
         futs.reserve(chunks.count());
@@ -75,24 +126,252 @@ public:
   }
 
   template <typename Fn, typename... Args>
-  constexpr std::future<std::invoke_result_t<Fn, Args...>>
+  constexpr future<std::invoke_result_t<Fn, Args...>>
   submit(Fn &&fn, Args &&...args) {
+    auto [t, fut] = package(FWD(fn), FWD(args)...);
+    schedule(std::move(t));
+    return std::move(fut);
+  }
+
+  // like submit(), but fails fast with an empty optional while the queue is
+  // full, whatever pool_options::on_overflow says
+  template <typename Fn, typename... Args>
+  std::optional<future<std::invoke_result_t<Fn, Args...>>> try_submit(Fn &&fn, Args &&...args) {
+    auto [t, fut] = package(FWD(fn), FWD(args)...);
+    if (!try_schedule(std::move(t)))
+      return std::nullopt;
+    return std::move(fut);
+  }
+
+  // like submit(), the handle can cancel the task. a task not started yet
+  // is skipped, a running one sees a stop request on the std::stop_token
+  // passed as first argument if fn takes one
+  template <typename Fn, typename... Args>
+  auto submit_cancellable(Fn &&fn, Args &&...args) {
+    constexpr bool takes_token = std::invocable<Fn, std::stop_token, Args...>;
+    using Ret = typename std::conditional_t<takes_token,
+                                            std::invoke_result<Fn, std::stop_token, Args...>,
+                                            std::invoke_result<Fn, Args...>>::type;
+    promise<Ret> p;
+    auto fut = p.get_future();
+    fut.via(this);
+    auto c = std::make_shared<detail::cancel_state>();
+    schedule(simple_task{[p = std::move(p), c, fn = FWD(fn), ... args = FWD(args)]() mutable {
+      if (!c->start()) {
+        p.set_exception(std::make_exception_ptr(task_cancelled{}));
+        return;
+      }
+      if constexpr (takes_token)
+        p.run([&] { return std::invoke(fn, c->src.get_token(), args...); });
+      else
+        p.run([&] { return std::invoke(fn, args...); });
+    }});
+    return task_handle<Ret>{std::move(fut), std::move(c)};
+  }
+
+  // task with priority prio, higher runs first. above the rt lane threshold
+  // it goes to the lane's SCHED_FIFO workers, otherwise to the pool's
+  // priority queue
+  template <typename Fn, typename... Args>
+  constexpr future<std::invoke_result_t<Fn, Args...>>
+  submit_priority(int prio, Fn &&fn, Args &&...args) {
     using Ret = std::invoke_result_t<Fn, Args...>;
-    std::packaged_task<Ret()> pt{std::bind_front(FWD(fn), FWD(args)...)};
-    auto fut = pt.get_future();
-    jobq_.schedule_task(simple_task{std::move(pt)});
-    scheduler_->wakeup();
+    promise<Ret> p;
+    auto fut = p.get_future();
+    fut.via(this);
+    priority_task<int> t{[p = std::move(p), f = std::bind_front(FWD(fn), FWD(args)...)]() mutable {
+      p.run(f);
+    }};
+    t.priority(prio);
+    t.track(inflight_);
+    if (rt_.accepts(prio)) {
+      rt_.push(std::move(t));
+    } else if (admit(jobq_.template typed_queue_for<priority_task<int>>(), t)) {
+      jobq_.schedule_task(std::move(t));
+      scheduler_->wakeup();
+    }
+    return fut;
+  }
+
+  // task of tenant t, queued on its own queue and run within its quota.
+  // throws std::out_of_range for a tenant not in pool_options::tenants
+  template <typename Fn, typename... Args>
+  future<std::invoke_result_t<Fn, Args...>> submit(tenant_id t, Fn &&fn, Args &&...args) {
+    using Ret = std::invoke_result_t<Fn, Args...>;
+    auto &q = jobq_.tenant(t);
+    promise<Ret> p;
+    auto fut = p.get_future();
+    fut.via(this);
+    simple_task task{[p = std::move(p), f = std::bind_front(FWD(fn), FWD(args)...)]() mutable {
+      p.run(f);
+    }};
+    task.track(inflight_);
+    if (admit(q, task)) {
+      q.push(std::move(task));
+      scheduler_->wakeup();
+    }
     return fut;
   }
 
+  [[nodiscard]] tenant_stats tenant_statistics(tenant_id t) const { return jobq_.tenant(t).stats(); }
+
+  // task which should start by deadline d, queued earliest deadline first.
+  // a task taken after d runs or is dropped as opts.on_deadline_miss says,
+  // either way it is counted in deadline_statistics()
+  template <typename Fn, typename... Args>
+  constexpr future<std::invoke_result_t<Fn, Args...>>
+  submit_deadline(deadline_clock::time_point d, Fn &&fn, Args &&...args) {
+    using Ret = std::invoke_result_t<Fn, Args...>;
+    promise<Ret> p;
+    auto fut = p.get_future();
+    fut.via(this);
+    deadline_task t{[p = std::move(p), f = std::bind_front(FWD(fn), FWD(args)...)]() mutable {
+      p.run(f);
+    }};
+    t.priority(d);
+    t.track(inflight_);
+    if (admit(jobq_.template typed_queue_for<deadline_task>(), t)) {
+      jobq_.schedule_task(std::move(t));
+      scheduler_->wakeup();
+    }
+    return fut;
+  }
+
+  // depth, bound and overflow counters of every task queue, fifo, priority,
+  // deadline and tenant queues in that order
+  [[nodiscard]] std::vector<queue_stats> queue_statistics() const { return jobq_.overflow_stats(); }
+
+  [[nodiscard]] deadline_stats deadline_statistics() const noexcept {
+    return jobq_.template typed_queue_for<deadline_task>().stats();
+  }
+
+  // lane workers running with SCHED_FIFO, 0 without the privilege for it
+  [[nodiscard]] unsigned realtime_workers() const noexcept { return rt_.realtime_workers(); }
+
+  // fire and forget, no future and no shared state. callable and arguments
+  // are kept inline in the task when they fit configs::task_storage_size(),
+  // an exception escaping fn terminates like it would on a std::thread
+  template <typename Fn, typename... Args>
+    requires std::invocable<std::decay_t<Fn>, std::decay_t<Args>...>
+  void post(Fn &&fn, Args &&...args) {
+    schedule(simple_task{[fn = FWD(fn), ... args = FWD(args)]() mutable {
+      std::invoke(std::move(fn), std::move(args)...);
+    }});
+  }
+
+  // one task per element of args, queued at once, wakes min(batch, idle) workers
+  template <typename Fn, std::ranges::input_range R>
+  [[nodiscard]] auto submit_bulk(Fn &&fn, R &&args) {
+    auto [tasks, fut] = make_task(bulk, FWD(fn), FWD(args));
+    if (const auto n = tasks.size(); n > 0) {
+      // the batch goes in as a whole once there is room, or is run or
+      // dropped task by task as pool_options::on_overflow says
+      auto &q = jobq_.template typed_queue_for<simple_task>();
+      for (auto &&t : tasks)
+        t.track(inflight_);
+      if (!q.full()) {
+        jobq_.schedule_task(std::move(tasks));
+      } else if (overflow_ == overflow_policy::eBlock && !worker_context::current()) {
+        q.count_blocked();
+        q.wait_for_room();
+        jobq_.schedule_task(std::move(tasks));
+      } else {
+        for (auto &&t : tasks)
+          if (admit(q, t))
+            q.push(std::move(t));
+      }
+      wake_workers(n, jobq_.template queue_for<simple_task>());
+    }
+    return fut;
+  }
+
+  // fn(args...) runs on the pool once d has passed. timers are kept in a
+  // hierarchical wheel with configs::timer_tick() resolution, expired ones
+  // are queued in batches by one timer thread. the returned timer cancels
+  // it, an exception escaping fn terminates like with post()
+  template <typename Fn, typename... Args>
+    requires std::invocable<std::decay_t<Fn> &, std::decay_t<Args> &...>
+  timer schedule_after(std::chrono::steady_clock::duration d, Fn &&fn, Args &&...args) {
+    return schedule_at(std::chrono::steady_clock::now() + d, FWD(fn), FWD(args)...);
+  }
+
+  template <typename Fn, typename... Args>
+    requires std::invocable<std::decay_t<Fn> &, std::decay_t<Args> &...>
+  timer schedule_at(std::chrono::steady_clock::time_point at, Fn &&fn, Args &&...args) {
+    return add_timer(at, {}, FWD(fn), FWD(args)...);
+  }
+
+  // fn(args...) runs every period, first after one period. a run is skipped
+  // while the previous one is still going
+  template <typename Fn, typename... Args>
+    requires std::invocable<std::decay_t<Fn> &, std::decay_t<Args> &...>
+  timer schedule_every(std::chrono::steady_clock::duration period, Fn &&fn, Args &&...args) {
+    return add_timer(std::chrono::steady_clock::now() + period, period, FWD(fn), FWD(args)...);
+  }
+
+  // co_await tp.schedule() continues the coroutine on a pool worker
+  [[nodiscard]] coro::resume_on schedule() noexcept { return coro::resume_on{*this}; }
+
+  // starts coroutine t on a pool worker, it gives the worker back whenever
+  // it suspends
+  template <typename T>
+  future<T> spawn(coro::pool_task<T> t) {
+    return coro::spawn(*this, std::move(t));
+  }
+
+  // runs t on the pool, e.g. continuation of a future. once the pool is
+  // stopped t runs on the calling thread, abandoned results still reach
+  // their continuations while queued tasks are destroyed
+  void execute(simple_task &&t) override {
+    if (stopped_.load(std::memory_order_acquire))
+      t.execute();
+    else
+      schedule(std::move(t));
+  }
+
+  // share of worker time each task queue got so far, fifo, priority and
+  // deadline queue in that order
+  [[nodiscard]] std::vector<double> queue_shares() const { return jobq_.busy_shares(); }
+
+  // some worker is idle right now
+  [[nodiscard]] bool has_idle_worker() const noexcept { return cpu_pool_.has_idle(); }
+
+  // a queue of this pool with tasks a worker could start now, for workers
+  // of other pools. nullptr if there is none or the pool is not running
+  task_queue *servable_queue() const noexcept {
+    if (stopped_.load(std::memory_order_acquire) || cpu_pool_.state() != stop_source_state_t::running)
+      return nullptr;
+    for (auto q : stats_.jobq.in.qs)
+      if (q->servable_size() > 0)
+        return q;
+    return nullptr;
+  }
+
+  // wakes an idle worker, it looks for tasks of other pools if its own are
+  // done. false if no worker is idle
+  bool wake_idle_worker() noexcept {
+    if (auto w = cpu_pool_.try_free_worker()) {
+      w->wakeup();
+      return true;
+    }
+    return false;
+  }
+
+  // workers with a thread right now, between elastic.min_threads and
+  // max_threads in an elastic pool
+  [[nodiscard]] unsigned running_workers() const noexcept { return cpu_pool_.running(); }
+
   ~threadpool();
 
-  // waits till condition of no tasks is satisfied
-  void drain();
+  // waits till no task is queued or running, tasks queued meanwhile
+  // included. on a paused pool that is once resumed
+  void drain() const noexcept;
 
-  // pause
-  void pause();
-  void resume();
+  // workers and the rt lane park once their current task returns, queued
+  // and newly submitted tasks wait for resume(). returns right away, a
+  // later drain() waits for the running tasks
+  void pause() noexcept;
+  void resume() noexcept;
 
   // quick shutdown, may not run all tasks
   void stop();
@@ -101,18 +380,152 @@ public:
   void shutdown();
 
 private:
+  // context of cpu_pool_ threads, waits on them help with queued tasks
+  struct helper final : worker_context {
+    helper(threadpool &tp, unsigned idx, worker &me) noexcept : tp_{tp}, idx_{idx}, me_{me} {}
+    void help(done_fn done, const void *arg) noexcept override;
+
+  private:
+    threadpool &tp_;
+    unsigned idx_;
+    worker &me_;
+  };
+
+  template <typename Fn, typename... Args>
+  timer add_timer(std::chrono::steady_clock::time_point at, std::chrono::steady_clock::duration period,
+                  Fn &&fn, Args &&...args) {
+    bool woken = false;
+    auto t = timers_.add(at, period, task_function{[fn = FWD(fn), ... args = FWD(args)]() mutable {
+      std::invoke(fn, args...);
+    }}, woken);
+    if (woken)
+      timer_->wakeup();
+    return t;
+  }
+
+  // timer thread, queues expired timers of timers_
+  void run_timers(managed_stop_token st);
+
+  // book keeper of an elastic pool, grows and shrinks cpu_pool_ as
+  // statistics suggest
+  void resize_workers(managed_stop_token st, const elastic_options &opts);
+
+  // fn(args...) as a task and the future of its result
+  template <typename Fn, typename... Args>
+  auto package(Fn &&fn, Args &&...args) {
+    using Ret = std::invoke_result_t<Fn, Args...>;
+    promise<Ret> p;
+    auto fut = p.get_future();
+    fut.via(this);
+    return std::pair{simple_task{[p = std::move(p), f = std::bind_front(FWD(fn), FWD(args)...)]() mutable {
+                       p.run(f);
+                     }},
+                     std::move(fut)};
+  }
+
+  void schedule(simple_task &&t) {
+    t.track(inflight_);
+    if (!tp_algo_.schedule_local(t) && !dispatch_direct(t) &&
+        admit(jobq_.template typed_queue_for<simple_task>(), t)) {
+      jobq_.schedule_task(std::move(t));
+      scheduler_->wakeup();
+    }
+  }
+
+  // like schedule(), but never waits for room or runs t on the caller.
+  // false if the queue is full, t is dropped then
+  bool try_schedule(simple_task &&t) {
+    t.track(inflight_);
+    if (tp_algo_.schedule_local(t) || dispatch_direct(t))
+      return true;
+    auto &q = jobq_.template typed_queue_for<simple_task>();
+    if (q.full()) {
+      q.count_rejected();
+      return false;
+    }
+    jobq_.schedule_task(std::move(t));
+    scheduler_->wakeup();
+    return true;
+  }
+
+  // makes room for t on q as pool_options::on_overflow says. false if t
+  // was run or is to be dropped instead of queued
+  template <typename Q, typename Task>
+  bool admit(Q &q, Task &t) {
+    if (!q.full())
+      return true;
+
+    switch (overflow_) {
+    case overflow_policy::eBlock:
+      // a worker waiting for room could be the one to make it
+      if (!worker_context::current()) {
+        q.count_blocked();
+        q.wait_for_room();
+        return true;
+      }
+      [[fallthrough]];
+    case overflow_policy::eCallerRuns:
+      q.count_rejected();
+      t.execute();
+      return false;
+    case overflow_policy::eDropOldest:
+      q.count_rejected();
+      if constexpr (requires { q.drop_oldest(); }) {
+        q.drop_oldest();
+        return true;
+      }
+      return false;
+    }
+    return true;
+  }
+
+  // hands t to an idle worker, skipping the scheduler thread.
+  // false if not in direct mode or no worker could take it
+  bool dispatch_direct(simple_task &t) noexcept {
+    if (dispatch_ != dispatch_mode::eDirect)
+      return false;
+
+    if (auto w = cpu_pool_.try_free_worker()) {
+      const bool taken = w->handoff(t);
+      // claimed worker must be woken, it is not idle anymore
+      w->wakeup();
+      return taken;
+    }
+    return false;
+  }
+
+  // wakes up to n idle workers to serve q, scheduler takes care of the rest
+  void wake_workers(std::size_t n, task_queue *q) noexcept {
+    for (; n > 0; --n) {
+      auto w = cpu_pool_.try_free_worker();
+      if (!w)
+        break;
+      w->serve(q);
+      w->wakeup();
+    }
+    if (n > 0)
+      scheduler_->wakeup();
+  }
+
   mutable std::mutex mu_;
   std::condition_variable_any shutdown_cv_, idle_cond_;
   managed_stop_source stop_src_, etc_stop_src_;
+  std::atomic<bool> stopped_;
+  std::atomic<std::uint32_t> inflight_; // queued and running tasks, see drain()
   // std::stop_callback<std::function<void()>> stop_cb_;
   job_queue<TaskQueueTupleType> jobq_;
   worker_pool<worker> cpu_pool_;
   worker_pool<worker> managers_;
-  //worker_pool<worker> book_keepers_;
+  worker_pool<worker> book_keepers_;
   worker *scheduler_;
+  worker *timer_;
+  ds::timer_wheel timers_;
   statistics stats_;
   unsigned max_threads_;
+  dispatch_mode dispatch_;
+  overflow_policy overflow_;
   scheduling_algo tp_algo_;
+  rt_lane rt_;
   std::once_flag del_flag_;
 
   TP_DELETE_COPY_ASSIGN(threadpool)
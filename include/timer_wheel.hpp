@@ -0,0 +1,282 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TIMER_WHEEL_HPP_
+#define TIMER_WHEEL_HPP_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "include/configuration.hpp"
+#include "include/task_type.hpp"
+
+namespace thp {
+namespace ds {
+
+struct timer_node;
+
+} // namespace ds
+
+// handle of a timer, cancel() keeps it from firing (again). copies refer
+// to the same timer, an empty handle refers to none
+class timer {
+public:
+  timer() noexcept = default;
+  explicit timer(std::weak_ptr<ds::timer_node> n) noexcept : node_{std::move(n)} {}
+
+  // false if the timer fired already (one shot) or was cancelled before
+  inline bool cancel() noexcept;
+
+private:
+  std::weak_ptr<ds::timer_node> node_;
+};
+
+namespace ds {
+
+class timer_wheel;
+
+struct timer_link {
+  timer_link *prev{nullptr}, *next{nullptr};
+};
+
+struct timer_node : timer_link, std::enable_shared_from_this<timer_node> {
+  timer_node(timer_wheel &wheel, task_function &&fn, std::uint64_t period) noexcept
+      : wheel{&wheel}, fn{std::move(fn)}, period{period} {}
+
+  timer_wheel *wheel;
+  task_function fn;
+  std::uint64_t period;    // ticks, 0 for one shot
+  std::uint64_t expiry{0}; // tick
+  std::uint16_t slot{0};
+  std::atomic<bool> running{false}; // runs of a periodic timer don't overlap
+  std::atomic<bool> cancelled{false}; // fire tasks queued before cancel() skip fn
+  std::shared_ptr<timer_node> self; // set while linked into the wheel
+
+  // body of the task queued when the timer fires
+  void fire() noexcept {
+    if (cancelled.load(std::memory_order_acquire))
+      return;
+    if (running.exchange(true, std::memory_order_acquire))
+      return; // previous period still running, this one is skipped
+    fn();
+    running.store(false, std::memory_order_release);
+  }
+};
+
+// hierarchical timing wheel, Levels wheels of 64 slots each. a timer sits
+// on the level of the highest tick digit (base 64) where its expiry differs
+// from the wheel's current tick and moves down a level whenever the tick
+// reaches its slot. insert and cancel are O(1) list operations, advancing
+// jumps straight to the next occupied slot found through a bitmap per
+// level. delays are capped at the span of the wheel, 2^36 ticks.
+class timer_wheel {
+public:
+  using clock = std::chrono::steady_clock;
+  using tick_type = std::uint64_t;
+  static constexpr unsigned Levels = 6;
+  static constexpr unsigned SlotBits = 6;
+  static constexpr unsigned Slots = 1u << SlotBits;
+  static constexpr tick_type Span = tick_type{1} << (Levels * SlotBits);
+  static constexpr tick_type Never = ~tick_type{0};
+
+  explicit timer_wheel(clock::duration resolution = configs::timer_tick(),
+                       clock::time_point epoch = clock::now()) noexcept
+      : resolution_{resolution}, epoch_{epoch}, now_{0}, pending_{0}, planned_{Never} {
+    for (auto &level : slots_)
+      for (auto &head : level)
+        head.prev = head.next = &head;
+  }
+
+  timer_wheel(const timer_wheel &) = delete;
+  timer_wheel &operator=(const timer_wheel &) = delete;
+
+  ~timer_wheel() {
+    std::lock_guard l{mu_};
+    for (auto &level : slots_)
+      for (auto &head : level)
+        while (head.next != &head)
+          unlink(node(head.next));
+  }
+
+  // ticks passed by t
+  [[nodiscard]] tick_type ticks_at(clock::time_point t) const noexcept {
+    return t <= epoch_ ? 0 : static_cast<tick_type>((t - epoch_) / resolution_);
+  }
+
+  // first tick at or after t
+  [[nodiscard]] tick_type tick_of(clock::time_point t) const noexcept {
+    if (t <= epoch_)
+      return 0;
+    return static_cast<tick_type>((t - epoch_ + resolution_ - clock::duration{1}) / resolution_);
+  }
+
+  [[nodiscard]] clock::time_point time_of(tick_type t) const noexcept {
+    return epoch_ + resolution_ * static_cast<clock::rep>(t);
+  }
+
+  // fn runs once at `at`, then every period if period is not zero.
+  // sets woken if the timer thread has to look at the wheel sooner than
+  // it planned
+  timer add(clock::time_point at, clock::duration period, task_function &&fn, bool &woken) {
+    const tick_type every = period > clock::duration::zero()
+        ? std::clamp<tick_type>(static_cast<tick_type>(period / resolution_), 1, Span - 1) : 0;
+    auto n = std::make_shared<timer_node>(*this, std::move(fn), every);
+    std::lock_guard l{mu_};
+    n->self = n;
+    n->expiry = std::clamp(tick_of(at), now_ + 1, now_ + Span - 1);
+    link(*n);
+    woken = n->expiry < planned_;
+    return timer{n};
+  }
+
+  bool cancel(timer_node &n) noexcept {
+    std::lock_guard l{mu_};
+    if (!n.self)
+      return false;
+    n.cancelled.store(true, std::memory_order_release);
+    unlink(n);
+    return true;
+  }
+
+  // moves the wheel to tick `to` and appends timers expired on the way to
+  // `out`, periodic ones are linked again for their next period. returns
+  // the tick the wheel has to be advanced at next, Never if empty
+  tick_type advance(tick_type to, std::vector<std::shared_ptr<timer_node>> &out) {
+    std::lock_guard l{mu_};
+    for (auto t = next_event(); t <= to; t = next_event()) {
+      now_ = t;
+      // higher levels first, their timers may land in lower slots of t
+      for (unsigned lvl = Levels - 1; lvl > 0; --lvl)
+        if ((t & ((tick_type{1} << (SlotBits * lvl)) - 1)) == 0)
+          cascade(lvl, digit(t, lvl));
+
+      auto &head = slots_[0][digit(t, 0)];
+      while (head.next != &head) {
+        auto &n = node(head.next);
+        auto self = n.self;
+        unlink(n);
+        out.push_back(self);
+        if (n.period) {
+          // missed periods are not caught up
+          n.expiry = std::max(n.expiry + n.period, t + 1);
+          n.self = std::move(self);
+          link(n);
+        }
+      }
+    }
+    now_ = std::max(now_, to);
+    planned_ = next_event();
+    return planned_;
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept {
+    std::lock_guard l{mu_};
+    return pending_;
+  }
+
+private:
+  static unsigned digit(tick_type t, unsigned lvl) noexcept {
+    return static_cast<unsigned>(t >> (SlotBits * lvl)) & (Slots - 1);
+  }
+
+  static timer_node &node(timer_link *l) noexcept { return *static_cast<timer_node *>(l); }
+
+  void link(timer_node &n) noexcept {
+    const auto diff = n.expiry ^ now_;
+    const unsigned lvl = diff ? std::min((63 - static_cast<unsigned>(std::countl_zero(diff))) / SlotBits,
+                                         Levels - 1)
+                              : 0;
+    const unsigned idx = digit(n.expiry, lvl);
+    n.slot = static_cast<std::uint16_t>(lvl * Slots + idx);
+
+    auto &head = slots_[lvl][idx];
+    n.prev = &head;
+    n.next = head.next;
+    head.next->prev = &n;
+    head.next = &n;
+    occupied_[lvl] |= std::uint64_t{1} << idx;
+    ++pending_;
+  }
+
+  void unlink(timer_node &n) noexcept {
+    const unsigned lvl = n.slot / Slots, idx = n.slot % Slots;
+    n.prev->next = n.next;
+    n.next->prev = n.prev;
+    auto &head = slots_[lvl][idx];
+    if (head.next == &head)
+      occupied_[lvl] &= ~(std::uint64_t{1} << idx);
+    n.prev = n.next = nullptr;
+    n.self.reset();
+    --pending_;
+  }
+
+  void cascade(unsigned lvl, unsigned idx) noexcept {
+    auto &head = slots_[lvl][idx];
+    while (head.next != &head) {
+      auto &n = node(head.next);
+      auto self = n.self;
+      unlink(n);
+      n.self = std::move(self);
+      link(n);
+    }
+  }
+
+  // tick of the next occupied slot. slots past the current digit belong to
+  // the current block of the level above, top level slots up to the current
+  // digit hold timers of the next round
+  tick_type next_event() const noexcept {
+    for (unsigned lvl = 0; lvl < Levels; ++lvl) {
+      const auto cur = digit(now_, lvl);
+      const auto shift = SlotBits * (lvl + 1);
+      auto block = (now_ >> shift) << shift;
+      auto later = cur + 1 < Slots ? occupied_[lvl] & (~std::uint64_t{0} << (cur + 1)) : 0;
+      if (lvl == Levels - 1 && !later && occupied_[lvl]) {
+        later = occupied_[lvl];
+        block += Span;
+      }
+      if (later)
+        return block | (static_cast<tick_type>(std::countr_zero(later)) << (SlotBits * lvl));
+    }
+    return Never;
+  }
+
+  clock::duration resolution_;
+  clock::time_point epoch_;
+  mutable std::mutex mu_;
+  tick_type now_;
+  std::size_t pending_;
+  tick_type planned_;
+  std::array<std::uint64_t, Levels> occupied_{};
+  std::array<std::array<timer_link, Slots>, Levels> slots_;
+};
+
+} // namespace ds
+
+bool timer::cancel() noexcept {
+  if (auto n = node_.lock())
+    return n->wheel->cancel(*n);
+  return false;
+}
+
+} // namespace thp
+
+#endif // TIMER_WHEEL_HPP_
@@ -21,10 +21,15 @@ limitations under the License.
 #include <functional>
 #include <future>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <tuple>
 #include <type_traits>
+#include <vector>
 
 #include "include/traits.hpp"
 #include "include/concepts.hpp"
+#include "include/future.hpp"
 
 namespace thp {
 
@@ -112,10 +117,168 @@ constexpr auto collect_future(V&& v) {
   return futs;
 }
 
-template < class InputIt >
-auto when_all(InputIt first, InputIt last) -> std::future<std::vector<typename std::iterator_traits<InputIt>::value_type>>
-{
+template <typename T> struct is_thp_future : std::false_type {};
+template <typename T> struct is_thp_future<future<T>> : std::true_type {};
+
+template <typename T>
+concept ThpFuture = is_thp_future<std::remove_cvref_t<T>>::value;
+
+// result of when_any, index of the first ready future and all the futures
+template <typename Seq>
+struct when_any_result {
+  std::size_t index;
+  Seq futures;
+};
+
+namespace detail {
+
+// applies fn(future, index) to every future of a vector or a tuple
+template <typename T, typename Fn>
+void for_each_future(std::vector<future<T>> &futs, Fn &&fn) {
+  for (std::size_t i = 0; i < futs.size(); ++i)
+    fn(futs[i], i);
+}
+
+template <typename... Ts, typename Fn>
+void for_each_future(std::tuple<future<Ts>...> &futs, Fn &&fn) {
+  [&]<std::size_t... I>(std::index_sequence<I...>) {
+    (fn(std::get<I>(futs), I), ...);
+  }(std::index_sequence_for<Ts...>{});
+}
+
+inline executor *first_executor(auto &futs) {
+  executor *ex = nullptr;
+  for_each_future(futs, [&](auto &f, std::size_t) {
+    if (ex == nullptr)
+      ex = f.get_executor();
+  });
+  return ex;
+}
+
+// one counter for all inputs, the last one to finish fulfils the promise.
+// counter starts at n+1 and the caller arrives too once every future has
+// its continuation, so futures aren't moved while being registered
+template <typename Seq>
+struct when_all_state {
+  explicit when_all_state(Seq &&s, std::size_t n) : futs{std::move(s)}, pending{n + 1} {}
+
+  void arrive() noexcept {
+    if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      p.set_value(std::move(futs));
+  }
+
+  Seq futs;
+  std::atomic<std::size_t> pending;
+  promise<Seq> p;
+};
+
+template <typename Seq>
+future<Seq> when_all(Seq futs, std::size_t n) {
+  auto *ex = first_executor(futs);
+  auto st = std::make_shared<when_all_state<Seq>>(std::move(futs), n);
+  auto res = st->p.get_future();
+  res.via(ex);
+  for_each_future(st->futs, [&](auto &f, std::size_t) {
+    f.on_ready(simple_task{[st] { st->arrive(); }});
+  });
+  st->arrive();
+  return res;
+}
+
+// first input to finish claims index, result is published by whoever of
+// winner and caller comes second
+template <typename Seq>
+struct when_any_state {
+  static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+  explicit when_any_state(Seq &&s) : futs{std::move(s)} {}
+
+  void finish(std::size_t i) noexcept {
+    auto expected = npos;
+    if (index.compare_exchange_strong(expected, i, std::memory_order_acq_rel))
+      arrive();
+  }
+
+  void arrive() noexcept {
+    if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      // losers give back their continuation, so they can be chained or
+      // awaited by the caller
+      for_each_future(futs, [](auto &f, std::size_t) { f.drop_on_ready(); });
+      p.set_value(when_any_result<Seq>{index.load(std::memory_order_relaxed), std::move(futs)});
+    }
+  }
+
+  Seq futs;
+  std::atomic<std::size_t> index{npos};
+  std::atomic<unsigned> pending{2};
+  promise<when_any_result<Seq>> p;
+};
+
+template <typename Seq>
+future<when_any_result<Seq>> when_any(Seq futs, std::size_t n) {
+  auto *ex = first_executor(futs);
+  auto st = std::make_shared<when_any_state<Seq>>(std::move(futs));
+  auto res = st->p.get_future();
+  res.via(ex);
+  for_each_future(st->futs, [&](auto &f, std::size_t i) {
+    f.on_ready(simple_task{[st, i] { st->finish(i); }});
+  });
+  if (n == 0)
+    st->finish(when_any_state<Seq>::npos);
+  st->arrive();
+  return res;
+}
+
+} // namespace detail
+
+// future of all input futures, ready once every one of them is ready.
+// nothing waits per input: each one decrements a shared counter when it
+// completes and the last one fulfils the result, so a consumer blocked in
+// get() or a then() continuation wakes up once. input futures are moved in
+// and returned ready, their errors stay with them.
+template <std::input_iterator InputIt>
+  requires ThpFuture<std::iter_value_t<InputIt>>
+auto when_all(InputIt first, InputIt last) {
+  std::vector<std::iter_value_t<InputIt>> futs(std::make_move_iterator(first),
+                                               std::make_move_iterator(last));
+  const auto n = futs.size();
+  return detail::when_all(std::move(futs), n);
+}
+
+template <typename T>
+future<std::vector<future<T>>> when_all(std::vector<future<T>> futs) {
+  const auto n = futs.size();
+  return detail::when_all(std::move(futs), n);
+}
+
+template <typename... Ts>
+  requires(sizeof...(Ts) > 0)
+auto when_all(future<Ts>... futs) {
+  return detail::when_all(std::make_tuple(std::move(futs)...), sizeof...(Ts));
+}
+
+// future ready as soon as any input is, tells which one. futures that were
+// still pending come back without a continuation, they can be waited on,
+// chained with then() or awaited again
+template <std::input_iterator InputIt>
+  requires ThpFuture<std::iter_value_t<InputIt>>
+auto when_any(InputIt first, InputIt last) {
+  std::vector<std::iter_value_t<InputIt>> futs(std::make_move_iterator(first),
+                                               std::make_move_iterator(last));
+  const auto n = futs.size();
+  return detail::when_any(std::move(futs), n);
+}
+
+template <typename T>
+future<when_any_result<std::vector<future<T>>>> when_any(std::vector<future<T>> futs) {
+  const auto n = futs.size();
+  return detail::when_any(std::move(futs), n);
+}
 
+template <typename... Ts>
+  requires(sizeof...(Ts) > 0)
+auto when_any(future<Ts>... futs) {
+  return detail::when_any(std::make_tuple(std::move(futs)...), sizeof...(Ts));
 }
 
 template<typename Tuple, std::size_t... I>
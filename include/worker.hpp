@@ -17,9 +17,12 @@ limitations under the License.
 #define WORKER_HPP_
 
 #include <atomic>
+#include <optional>
 
+#include "include/configuration.hpp"
 #include "include/managed_thread.hpp"
 #include "include/task_queue.hpp"
+#include "platform/eventcount.hpp"
 
 namespace thp {
 
@@ -29,23 +32,32 @@ struct worker : managed_thread {
 
   template <typename Fn, typename... Args>
   explicit worker(const managed_stop_source &stop_src, Fn &&fn, Args &&...args)
-      : taskq_{nullptr}, sema_{0}, th_{std::make_unique<platform::thread>(
-                                       stop_src, FWD(fn), FWD(args)...)} {}
+      : taskq_{nullptr}, inbox_state_{inbox::empty}, inbox_{},
+        parker_{configs::park_spin_limit()}, retire_{false},
+        th_{std::make_unique<platform::thread>(stop_src, FWD(fn), FWD(args)...)} {}
 
+  // slot without a thread yet, see restart()
+  worker() noexcept
+      : taskq_{nullptr}, inbox_state_{inbox::empty}, inbox_{},
+        parker_{configs::park_spin_limit()}, retire_{false}, th_{} {}
+
+  // inbox is not moved, workers are moved only before any task is handed off
   worker(worker &&rhs) noexcept
-      : taskq_{nullptr}, sema_{0}, th_{std::move(rhs.th_)} {
+      : taskq_{nullptr}, inbox_state_{inbox::empty}, inbox_{},
+        parker_{configs::park_spin_limit()}, retire_{false},
+        th_{std::move(rhs.th_)} {
     taskq_.store(rhs.taskq_.load());
-    if (rhs.sema_.try_acquire())
-      sema_.release();
+    if (rhs.parker_.try_park())
+      parker_.unpark();
 
     rhs.taskq_.store(nullptr);
-    rhs.sema_.release();
+    rhs.parker_.unpark();
   }
 
   worker &operator=(worker &&rhs) noexcept {
     if (this != &rhs) {
-      if (rhs.sema_.try_acquire())
-        sema_.release();
+      if (rhs.parker_.try_park())
+        parker_.unpark();
 
       th_ = std::move(rhs.th_);
       taskq_.store(rhs.taskq_.load());
@@ -65,21 +77,71 @@ struct worker : managed_thread {
     return taskq_.load(std::memory_order_acquire);
   }
 
-  bool joinable() noexcept override { return th_->joinable(); }
+  // gives a task straight to this worker, caller must have claimed the worker
+  // from its pool and wake it afterwards. t is moved from only on success,
+  // fails if an earlier handoff is not run yet
+  bool handoff(simple_task &t) noexcept {
+    auto expected = inbox::empty;
+    if (!inbox_state_.compare_exchange_strong(expected, inbox::busy,
+                                              std::memory_order_acquire,
+                                              std::memory_order_relaxed))
+      return false;
+    inbox_.emplace(std::move(t));
+    inbox_state_.store(inbox::full, std::memory_order_release);
+    return true;
+  }
+
+  // a handoff is waiting to be run
+  bool has_handoff() const noexcept {
+    return inbox_state_.load(std::memory_order_acquire) != inbox::empty;
+  }
+
+  // worker thread only, runs the handed off task if any
+  bool run_handoff() noexcept {
+    if (inbox_state_.load(std::memory_order_acquire) != inbox::full)
+      return false;
+    auto t = std::move(inbox_.value());
+    inbox_.reset();
+    inbox_state_.store(inbox::empty, std::memory_order_release);
+    t.execute();
+    return true;
+  }
+
+  // asks the thread to leave its loop, caller must have claimed the worker
+  // from its pool and wake it afterwards
+  void request_retire() noexcept { retire_.store(true, std::memory_order_release); }
+
+  bool retiring() const noexcept { return retire_.load(std::memory_order_acquire); }
+
+  // runs fn on a new thread of this slot, once the previous one left its
+  // loop. the old thread is joined without stopping the pool
+  template <typename Fn, typename... Args>
+  void restart(const managed_stop_source &stop_src, Fn &&fn, Args &&...args) {
+    if (th_)
+      th_->retire();
+    taskq_.store(nullptr, std::memory_order_relaxed);
+    retire_.store(false, std::memory_order_relaxed);
+    th_ = std::make_unique<platform::thread>(stop_src, FWD(fn), FWD(args)...);
+  }
+
+  bool joinable() noexcept override { return th_ && th_->joinable(); }
   std::thread::native_handle_type native_handle() override {
     return th_->native_handle();
   }
-  std::thread::id get_id() noexcept { return th_->get_id(); }
+  std::thread::id get_id() noexcept { return th_ ? th_->get_id() : std::thread::id{}; }
   void join() override {
-    if (th_->joinable()) {
+    if (joinable()) {
       th_->join();
     }
   }
   bool request_stop() override { return th_->request_stop(); }
   void request_resume() override { th_->request_resume(); }
   void request_pause() override { th_->request_pause(); }
-  void sleep() noexcept override { sema_.acquire(); }
-  void wakeup() noexcept override { sema_.release(); }
+  bool pause_requested() const noexcept override { return th_ && th_->pause_requested(); }
+  void sleep() noexcept override { parker_.park(); }
+  // false on timeout
+  bool sleep_for(std::chrono::nanoseconds d) noexcept { return parker_.park_for(d); }
+  void wakeup() noexcept override { parker_.unpark(); }
 
   std::weak_ptr<thread_configuration> config() override {
     return th_->config();
@@ -87,8 +149,13 @@ struct worker : managed_thread {
   ~worker() = default;
 
 private:
+  enum class inbox : uint8_t { empty, busy, full };
+
   alignas(hardware_destructive_interference_size) std::atomic<task_queue *> taskq_;
-  std::binary_semaphore sema_;
+  std::atomic<inbox> inbox_state_;
+  std::optional<simple_task> inbox_;
+  platform::parker parker_;
+  std::atomic<bool> retire_;
   std::unique_ptr<platform::thread> th_;
 };
 
@@ -18,7 +18,7 @@ limitations under the License.
 
 #include <algorithm>
 #include <cassert>
-#include <climits>
+#include <functional>
 #include <mutex>
 #include <ranges>
 #include <semaphore>
@@ -26,8 +26,10 @@ limitations under the License.
 #include <thread>
 #include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "include/atomic_bitmap.hpp"
 #include "include/concepts.hpp"
 #include "include/configuration.hpp"
 #include "include/coroutine/generator.hpp"
@@ -41,11 +43,10 @@ namespace vw = std::ranges::views;
 template <kncpt::ManageableThread WorkerType>
 struct worker_pool {
   explicit worker_pool(std::string_view name, unsigned n)
-      : mu_{}, free_workers_{0}, threads_{}, workers_{}, max_workers_{n},
-        name_{name}, device_name_{"cpu"}, stop_src_{}, cond_{}
+      : mu_{}, free_workers_{n}, threads_{}, workers_{}, max_workers_{n},
+        running_{0}, worker_fn_{}, idle_fn_{}, name_{name}, device_name_{"cpu"}, stop_src_{}, cond_{}
   {
-    if (n > MaxIndex)
-      throw std::logic_error("requested worker pool size is greater");
+    threads_.reserve(n);
   }
 
   template <typename... Fn> decltype(auto) run(Fn &&...fn) {
@@ -53,41 +54,125 @@ struct worker_pool {
     return std::make_tuple(start_worker(FWD(fn))...);
   }
 
+  // every worker runs its own copy of fn
   template <typename Fn>
   auto start(Fn &&fn) -> std::vector<std::thread::id> {
     std::unique_lock l(mu_);
     std::vector<std::thread::id> ids;
     rng::transform(vw::iota(0u, max_workers_), std::back_inserter(ids), [&](unsigned) {
-                  return start_worker(FWD(fn)); });
+                  return start_worker(std::as_const(fn)); });
     std::erase(ids, std::thread::id{});
     return ids;
   }
 
+  // elastic pool, starts n of size() workers. the other slots stay empty
+  // till grow() gives them a thread running fn
+  template <typename Fn>
+    requires std::is_copy_constructible_v<std::decay_t<Fn>>
+  auto start(Fn &&fn, unsigned n) -> std::vector<std::thread::id> {
+    std::unique_lock l(mu_);
+    worker_fn_ = fn;
+    std::vector<std::thread::id> ids;
+    rng::transform(vw::iota(0u, std::min(n, max_workers_)), std::back_inserter(ids), [&](unsigned) {
+                  return start_worker(worker_fn_); });
+    std::erase(ids, std::thread::id{});
+    while (threads_.size() < max_workers_)
+      threads_.emplace_back();
+    return ids;
+  }
+
+  // starts up to n more workers in empty or retired slots, returns how many
+  // started. grow() and retire_idle() are meant for a single caller
+  unsigned grow(unsigned n) {
+    std::unique_lock l(mu_);
+    unsigned started = 0;
+    for (unsigned idx = 0; idx < threads_.size() && started < n; ++idx) {
+      auto &w = threads_[idx];
+      if (!worker_fn_ || stop_src_.stop_requested())
+        break;
+      if (w.joinable() && !w.retiring())
+        continue;
+      try {
+        workers_.erase(w.get_id());
+        w.restart(stop_src_, worker_fn_, stop_src_.get_managed_token());
+        workers_.emplace(w.get_id(), idx);
+        running_.fetch_add(1, std::memory_order_relaxed);
+        ++started;
+      } catch (std::exception &e) {
+        break;
+      }
+    }
+    return started;
+  }
+
+  // retires up to n idle workers, their threads leave the worker loop and
+  // exit. returns how many were retired
+  unsigned retire_idle(unsigned n) noexcept {
+    unsigned retired = 0;
+    for (; retired < n; ++retired) {
+      auto idx = free_workers_.acquire_any();
+      if (!idx)
+        break;
+      threads_[idx.value()].request_retire();
+      threads_[idx.value()].wakeup();
+      running_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return retired;
+  }
+
   void not_working(const unsigned idx) noexcept {
-    auto old_val = free_workers_.load(std::memory_order_relaxed);
-    auto new_val = old_val | (1ll << idx);
-    while (!free_workers_.compare_exchange_weak(
-        old_val, new_val, std::memory_order_release, std::memory_order_relaxed));
+    free_workers_.set(idx);
+    // orders idle mark before caller's recheck of queues
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
 
-    free_workers_.notify_one();
+  // takes back idle mark of a worker, false if someone else claimed it already
+  bool claim(const unsigned idx) noexcept {
+    return free_workers_.reset(idx);
   }
 
   WorkerType &free_worker(statistics &) noexcept {
-    auto idx = 0;
-    std::int64_t old_val = 0;
-    do {
-      free_workers_.wait(0ll, std::memory_order_acquire);
-      old_val = free_workers_.load(std::memory_order_relaxed);
-      idx = __builtin_ffsll(old_val);
-    } while (idx == 0ll);
+    return std::ref(threads_[free_workers_.wait_acquire_any()]);
+  }
+
+  // non blocking version of free_worker
+  WorkerType *try_free_worker() noexcept {
+    // orders caller's enqueue before looking for idle workers
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (auto idx = free_workers_.acquire_any())
+      return std::addressof(threads_[idx.value()]);
+    return nullptr;
+  }
+
+  unsigned size() const noexcept { return max_workers_; }
+
+  // workers with a thread, less than size() in an elastic pool
+  unsigned running() const noexcept { return running_.load(std::memory_order_relaxed); }
 
-    auto new_val = old_val & (~(1ll << (idx - 1)));
-    while (!free_workers_.compare_exchange_weak(
-        old_val, new_val, std::memory_order_release, std::memory_order_relaxed));
+  bool has_idle() const noexcept { return !free_workers_.none(); }
 
-    return std::ref(threads_[idx - 1]);
+  stop_source_state_t state() const noexcept { return stop_src_.current_state(); }
+
+  // fn points an idle worker to a queue with tasks elsewhere, nullptr if
+  // there is none. set before workers start
+  void on_idle(std::function<task_queue *()> fn) { idle_fn_ = std::move(fn); }
+
+  // worker idx, marked idle by not_working(), runs one task of the queue
+  // on_idle points to. false if there is none or someone claimed the
+  // worker meanwhile, it sleeps then. a producer of the other queue either
+  // sees the worker idle and wakes it, or the worker sees its task here
+  bool find_work(unsigned idx, WorkerType &me) noexcept {
+    if (!idle_fn_)
+      return false;
+    auto q = idle_fn_();
+    if (!q || !claim(idx))
+      return false;
+    q->accept_one(me);
+    return true;
   }
 
+  unsigned idle() const noexcept { return free_workers_.count(); }
+
   std::optional<std::tuple<unsigned int, thp::worker&>>
   worker_info(const std::thread::id &id) noexcept {
     std::shared_lock l(mu_);
@@ -103,8 +188,14 @@ struct worker_pool {
     return threads_[workers_[id]].config();
   }
 
-  void pause() {}
-  void resume() {}
+  // workers park once their current task returns and stay parked, wakeups
+  // included, till resume()
+  void pause() noexcept { stop_src_.request_pause(); }
+
+  void resume() noexcept {
+    if (stop_src_.request_resume())
+      wakeup_all();
+  }
 
   void shutdown() {
     if (stop_src_.request_stop()) {
@@ -131,12 +222,13 @@ protected:
   template <typename F>
   std::thread::id start_worker(F &&f) {
     try {
-      static unsigned int idx = 0;
-      if (idx < MaxIndex) {
+      const unsigned idx = threads_.size();
+      if (idx < max_workers_) {
         WorkerType w(stop_src_, FWD(f), stop_src_.get_managed_token());
         auto id = w.get_id();
-        workers_.emplace(id, idx++);
+        workers_.emplace(id, idx);
         threads_.emplace_back(std::move(w));
+        running_.fetch_add(1, std::memory_order_relaxed);
         return id;
       }
     }
@@ -146,17 +238,15 @@ protected:
   }
 
 private:
-
-  using BITVEC = std::int_fast64_t;
-  static const unsigned MaxIndex = CHAR_BIT * sizeof(BITVEC);
-
   alignas(std::hardware_destructive_interference_size) mutable platform::
       spin_shared_mutex mu_;
-  alignas(std::hardware_destructive_interference_size)
-      std::atomic<BITVEC> free_workers_;
+  ds::atomic_bitmap free_workers_;
   std::vector<WorkerType> threads_;
   std::unordered_map<std::thread::id, unsigned int> workers_; // std::flatmap
   unsigned max_workers_;
+  std::atomic<unsigned> running_;
+  std::function<void(managed_stop_token)> worker_fn_; // of elastic pools
+  std::function<task_queue *()> idle_fn_;
   std::string name_;
   std::string device_name_;
   managed_stop_source stop_src_;
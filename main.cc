@@ -50,12 +50,22 @@ auto throw_fn = [](auto&& x) {
   return v;
 };
 
+// pool futures are collected with one wakeup, std::future one by one
+template<typename T>
+vector<thp::future<T>> all_ready(vector<thp::future<T>>& vals) {
+  return thp::util::when_all(std::move(vals)).get();
+}
+
+template<typename T>
+vector<std::future<T>>& all_ready(vector<std::future<T>>& vals) { return vals; }
+
 template<typename T>
 void print_stats(T& vals, std::ostream& oss) {
   try {
     auto n = vals.size();
     vector<long int> data(n, 0);
-    rng::transform(vals, data.begin(), [](auto&& f) { return f.get(); });
+    auto&& ready = all_ready(vals);
+    rng::transform(ready, data.begin(), [](auto&& f) { return f.get(); });
     uint64_t total = std::accumulate(data.cbegin(), data.cend(), uint64_t(0));
     auto [mn, mx] = rng::minmax_element(data);
     oss << "# mean: " << total/n << " us\n";
@@ -88,9 +98,10 @@ std::optional<size_t> is_prime(size_t n) {
   return {n};
 }
 
-void tp_schedule(size_t n, size_t w, std::ostream& oss) {
-   thp::threadpool tp(w);
-   std::vector<std::future<long int>> futs;
+void tp_schedule(size_t n, size_t w, std::ostream& oss,
+                 thp::dispatch_mode dispatch = thp::dispatch_mode::eScheduler) {
+   thp::threadpool tp(thp::pool_options{.max_threads = unsigned(w), .dispatch = dispatch});
+   std::vector<thp::future<long int>> futs;
    futs.reserve(n);
 
    std::generate_n(std::back_inserter(futs), n, [&] {
@@ -139,6 +150,9 @@ int collect_stats(int argc, const char* const argv[])
 
     oss << "# tp_schedule(" << n << ", " << w << ")\n";
     tp_schedule(n, w, oss);
+
+    oss << "# tp_schedule_direct(" << n << ", " << w << ")\n";
+    tp_schedule(n, w, oss, thp::dispatch_mode::eDirect);
   
     copy(istream_iterator<string>(oss), istream_iterator<string>(),
          ostream_iterator<string>(cout, "\n"));
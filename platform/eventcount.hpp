@@ -0,0 +1,199 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef EVENTCOUNT_HPP__
+#define EVENTCOUNT_HPP__
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace thp {
+namespace platform {
+
+inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+// returns false on timeout
+inline bool futex_wait(std::atomic<std::uint32_t> &word, std::uint32_t expected,
+                       const struct timespec *timeout = nullptr) noexcept {
+  const auto rc = ::syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word),
+                            FUTEX_WAIT_PRIVATE, expected, timeout, nullptr, 0);
+  return !(rc == -1 && errno == ETIMEDOUT);
+}
+
+inline void futex_wake(std::atomic<std::uint32_t> &word, int n) noexcept {
+  ::syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word),
+            FUTEX_WAKE_PRIVATE, n, nullptr, nullptr, 0);
+}
+
+// eventcount, lets threads wait for a condition without a lock.
+//   waiter:   auto k = ec.prepare_wait();
+//             if (condition()) ec.cancel_wait(); else ec.wait(k);
+//   notifier: make condition() true; ec.notify_one();
+// notify is a single load when nobody waits.
+struct event_count {
+  using key_type = std::uint32_t;
+
+  key_type prepare_wait() noexcept {
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    return epoch_.load(std::memory_order_seq_cst);
+  }
+
+  void cancel_wait() noexcept {
+    waiters_.fetch_sub(1, std::memory_order_seq_cst);
+  }
+
+  void wait(key_type key) noexcept {
+    while (epoch_.load(std::memory_order_acquire) == key)
+      futex_wait(epoch_, key);
+    waiters_.fetch_sub(1, std::memory_order_seq_cst);
+  }
+
+  void notify_one() noexcept { notify(1); }
+  void notify_all() noexcept { notify(INT32_MAX); }
+
+private:
+  void notify(int n) noexcept {
+    // orders caller's condition update before reading waiters
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_seq_cst) == 0)
+      return;
+    epoch_.fetch_add(1, std::memory_order_seq_cst);
+    futex_wake(epoch_, n);
+  }
+
+  std::atomic<std::uint32_t> epoch_{0};
+  std::atomic<std::uint32_t> waiters_{0};
+};
+
+// single owner parking spot with one permit, like a binary semaphore.
+// before going into the kernel the owner spins for a window sized from the
+// recently observed gaps between park and wakeup: short gaps (bursty load)
+// are served by spinning, long gaps (idle) park right away.
+struct parker {
+  using clock = std::chrono::steady_clock;
+
+  explicit parker(std::chrono::nanoseconds spin_limit = std::chrono::microseconds(50))
+      : state_{empty}, spin_limit_{spin_limit}, avg_gap_{spin_limit} {}
+
+  parker(const parker &) = delete;
+  parker &operator=(const parker &) = delete;
+
+  // owner only, blocks till a permit is available and takes it
+  void park() noexcept {
+    const auto start = clock::now();
+    if (!spin(start)) {
+      // empty -> parked, or notified -> empty
+      if (state_.fetch_sub(1, std::memory_order_acquire) != notified) {
+        do {
+          futex_wait(state_, parked);
+        } while (!take_permit(notified));
+      }
+    }
+    observe(clock::now() - start);
+  }
+
+  // owner only, false if no permit arrived within d
+  bool park_for(std::chrono::nanoseconds d) noexcept {
+    const auto start = clock::now();
+    if (spin(start) || state_.fetch_sub(1, std::memory_order_acquire) == notified) {
+      observe(clock::now() - start);
+      return true;
+    }
+
+    const auto deadline = start + d;
+    while (true) {
+      const auto left = deadline - clock::now();
+      if (left > std::chrono::nanoseconds::zero()) {
+        const auto s = std::chrono::duration_cast<std::chrono::seconds>(left);
+        const struct timespec ts {
+          static_cast<std::time_t>(s.count()),
+          static_cast<long>(std::chrono::duration_cast<std::chrono::nanoseconds>(left - s).count())
+        };
+        futex_wait(state_, parked, &ts);
+      }
+      if (take_permit(notified)) {
+        observe(clock::now() - start);
+        return true;
+      }
+      if (clock::now() >= deadline) {
+        auto expected = parked;
+        if (state_.compare_exchange_strong(expected, empty, std::memory_order_relaxed))
+          return false;
+        // unpark raced with timeout
+        return take_permit(notified);
+      }
+    }
+  }
+
+  // takes the permit if available, never blocks
+  bool try_park() noexcept { return take_permit(notified); }
+
+  // any thread, makes a permit available and wakes owner if it is parked
+  void unpark() noexcept {
+    if (state_.exchange(notified, std::memory_order_release) == parked)
+      futex_wake(state_, 1);
+  }
+
+private:
+  static constexpr std::uint32_t empty = 0;
+  static constexpr std::uint32_t notified = 1;
+  static constexpr std::uint32_t parked = UINT32_MAX; // empty - 1
+
+  bool take_permit(std::uint32_t from) noexcept {
+    return state_.compare_exchange_strong(from, empty, std::memory_order_acquire,
+                                          std::memory_order_relaxed);
+  }
+
+  bool spin(clock::time_point start) noexcept {
+    const auto window = avg_gap_ < spin_limit_ ? 2 * avg_gap_ : clock::duration::zero();
+    if (take_permit(notified))
+      return true;
+
+    for (unsigned i = 1; window > clock::duration::zero(); ++i) {
+      cpu_relax();
+      if (state_.load(std::memory_order_relaxed) == notified && take_permit(notified))
+        return true;
+      if ((i & 63) == 0 && clock::now() - start > window)
+        break;
+    }
+    return false;
+  }
+
+  // moving average of wakeup gaps, owner only
+  void observe(clock::duration gap) noexcept {
+    avg_gap_ = (7 * avg_gap_ + std::chrono::duration_cast<std::chrono::nanoseconds>(gap)) / 8;
+  }
+
+  std::atomic<std::uint32_t> state_;
+  std::chrono::nanoseconds spin_limit_;
+  std::chrono::nanoseconds avg_gap_;
+};
+
+} // namespace platform
+} // namespace thp
+
+#endif // EVENTCOUNT_HPP__
@@ -0,0 +1,204 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef NUMA_HPP__
+#define NUMA_HPP__
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <map>
+#include <filesystem>
+#include <fstream>
+#include <sched.h>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace thp {
+namespace platform {
+
+struct numa_node {
+  unsigned id;
+  std::vector<unsigned> cpus;
+};
+
+// "0-3,8,10-11" -> {0,1,2,3,8,10,11}, malformed parts are skipped
+inline std::vector<unsigned> parse_cpulist(std::string_view list) {
+  std::vector<unsigned> cpus;
+  auto number = [](std::string_view s, unsigned &v) {
+    auto [p, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+    return ec == std::errc{} && p == s.data() + s.size();
+  };
+
+  while (!list.empty()) {
+    const auto comma = list.find(',');
+    auto part = list.substr(0, comma);
+    list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+    while (!part.empty() && std::isspace(static_cast<unsigned char>(part.back())))
+      part.remove_suffix(1);
+
+    unsigned lo = 0, hi = 0;
+    const auto dash = part.find('-');
+    if (dash == std::string_view::npos) {
+      if (number(part, lo))
+        cpus.push_back(lo);
+    } else if (number(part.substr(0, dash), lo) && number(part.substr(dash + 1), hi)) {
+      for (auto c = lo; c <= hi; ++c)
+        cpus.push_back(c);
+    }
+  }
+  return cpus;
+}
+
+// cpus this process may run on
+inline std::vector<unsigned> allowed_cpus() {
+  std::vector<unsigned> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (unsigned c = 0; c < CPU_SETSIZE; ++c)
+      if (CPU_ISSET(c, &set))
+        cpus.push_back(c);
+  }
+  return cpus;
+}
+
+// numa nodes with cpus usable by this process, read from sysfs.
+// without numa support all cpus make up node 0
+inline std::vector<numa_node> numa_topology(const std::filesystem::path &root = "/sys/devices/system/node") {
+  auto allowed = allowed_cpus();
+  if (allowed.empty())
+    for (unsigned c = 0; c < std::max(1u, std::thread::hardware_concurrency()); ++c)
+      allowed.push_back(c);
+
+  std::vector<numa_node> nodes;
+  std::error_code ec;
+  for (auto &entry : std::filesystem::directory_iterator(root, ec)) {
+    const auto name = entry.path().filename().string();
+    unsigned id = 0;
+    if (!name.starts_with("node") ||
+        std::from_chars(name.data() + 4, name.data() + name.size(), id).ec != std::errc{})
+      continue;
+
+    std::ifstream f(entry.path() / "cpulist");
+    std::string list;
+    std::getline(f, list);
+
+    numa_node n{id, {}};
+    for (auto c : parse_cpulist(list))
+      if (std::ranges::binary_search(allowed, c))
+        n.cpus.push_back(c);
+    if (!n.cpus.empty())
+      nodes.push_back(std::move(n));
+  }
+
+  if (nodes.empty())
+    nodes.push_back({0, std::move(allowed)});
+  std::ranges::sort(nodes, {}, &numa_node::id);
+  return nodes;
+}
+
+// how workers of a pool are placed on cpus
+enum class pin_policy : std::uint8_t {
+  eNone = 0,      // not pinned, may float over the pool's cpus
+  eCompact,       // worker i on i-th cpu, hyperthread siblings next to each other
+  eScatter,       // consecutive workers on different packages, then cores
+  ePhysicalCores, // one worker per physical core, siblings are left free
+  eExplicit,      // worker i on i-th cpu of the given list
+};
+
+struct cpu_info {
+  unsigned cpu;
+  unsigned package;
+  unsigned core;
+};
+
+// package and core of every cpu, read from sysfs. a cpu without topology
+// information counts as its own core on package 0
+inline std::vector<cpu_info> cpu_topology(const std::vector<unsigned> &cpus,
+                                          const std::filesystem::path &root = "/sys/devices/system/cpu") {
+  auto read = [](const std::filesystem::path &p, unsigned fallback) {
+    std::ifstream f(p);
+    unsigned v;
+    return (f >> v) ? v : fallback;
+  };
+
+  std::vector<cpu_info> info;
+  for (auto c : cpus) {
+    const auto dir = root / ("cpu" + std::to_string(c)) / "topology";
+    info.push_back({c, read(dir / "physical_package_id", 0), read(dir / "core_id", c)});
+  }
+  return info;
+}
+
+// cpus in the order workers are placed on them, worker i goes to
+// order[i % order.size()]. empty for eNone
+inline std::vector<unsigned> pin_order(pin_policy policy, std::vector<cpu_info> cpus) {
+  std::vector<unsigned> order;
+  auto by_position = [](const cpu_info &a, const cpu_info &b) {
+    return std::tie(a.package, a.core, a.cpu) < std::tie(b.package, b.core, b.cpu);
+  };
+
+  switch (policy) {
+  case pin_policy::eNone:
+    break;
+  case pin_policy::eExplicit:
+    for (auto &&c : cpus)
+      order.push_back(c.cpu);
+    break;
+  case pin_policy::eCompact:
+    std::ranges::sort(cpus, by_position);
+    for (auto &&c : cpus)
+      order.push_back(c.cpu);
+    break;
+  case pin_policy::ePhysicalCores:
+    std::ranges::sort(cpus, by_position);
+    for (std::size_t i = 0; i < cpus.size(); ++i)
+      if (i == 0 || cpus[i].package != cpus[i - 1].package || cpus[i].core != cpus[i - 1].core)
+        order.push_back(cpus[i].cpu);
+    break;
+  case pin_policy::eScatter: {
+    // per package: first sibling of every core, then second siblings ...
+    std::ranges::sort(cpus, by_position);
+    std::map<unsigned, std::vector<unsigned>> packages;
+    std::map<std::pair<unsigned, unsigned>, unsigned> sibling;
+    std::vector<std::pair<unsigned, unsigned>> ranked; // (sibling rank, cpu)
+    for (auto &&c : cpus)
+      ranked.emplace_back(sibling[{c.package, c.core}]++, c.cpu);
+    std::ranges::stable_sort(ranked, {}, &std::pair<unsigned, unsigned>::first);
+    for (auto &&[rank, cpu] : ranked) {
+      const auto it = std::ranges::find(cpus, cpu, &cpu_info::cpu);
+      packages[it->package].push_back(cpu);
+    }
+    // round robin over packages
+    for (std::size_t i = 0; order.size() < cpus.size(); ++i)
+      for (auto &&[_, list] : packages)
+        if (i < list.size())
+          order.push_back(list[i]);
+    break;
+  }
+  }
+  return order;
+}
+
+} // namespace platform
+} // namespace thp
+
+#endif // NUMA_HPP__
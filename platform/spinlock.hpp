@@ -12,6 +12,13 @@ struct spin_mutex {
         auto ticket = in.fetch_add(1, std::memory_order_relaxed);
         while(out.load(std::memory_order_acquire) != ticket);
     }
+    bool try_lock() noexcept {
+        // only take a ticket if nobody holds or waits for the lock
+        auto ticket = out.load(std::memory_order_acquire);
+        return in.compare_exchange_strong(ticket, ticket + 1,
+                                          std::memory_order_acquire,
+                                          std::memory_order_relaxed);
+    }
     void unlock() noexcept
     {
         out.store(out.load(std::memory_order_relaxed) + 1, std::memory_order_release);
@@ -66,9 +66,8 @@ thread_configuration &thread_config::set_policy(int policy) {
 }
 
 thread_configuration &thread_config::set_affinity(std::vector<unsigned> cpuid) {
-  int arr[64];
-  std::copy(cpuid.begin(), cpuid.end(), arr);
-  config_set_affinity(conf_, arr, cpuid.size());
+  std::vector<int> arr(cpuid.begin(), cpuid.end());
+  config_set_affinity(conf_, arr.data(), arr.size());
   return *this;
 }
 
@@ -0,0 +1,100 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <sched.h>
+#include <stdexcept>
+
+#include "include/numa_pool.hpp"
+
+namespace thp {
+
+numa_pool::numa_pool(const pool_options &opts, std::vector<platform::numa_node> topology)
+  : topology_{std::move(topology)}
+  , cpu_node_{}
+  , pools_{}
+  , ready_{0}
+{
+  if (topology_.empty())
+    throw std::invalid_argument("numa_pool: no numa node");
+  // workers of built nodes read pools_ while later ones are added
+  pools_.reserve(topology_.size());
+
+  std::size_t total_cpus = 0;
+  for (auto &&n : topology_)
+    total_cpus += n.cpus.size();
+
+  unsigned assigned = 0;
+  for (unsigned i = 0; i < topology_.size(); ++i) {
+    const auto &n = topology_[i];
+    for (auto c : n.cpus) {
+      if (c >= cpu_node_.size())
+        cpu_node_.resize(c + 1, 0);
+      cpu_node_[c] = i;
+    }
+
+    // share of max_threads by cpu count, last node takes the rest
+    unsigned workers = i + 1 == topology_.size()
+        ? opts.max_threads - std::min(assigned, opts.max_threads)
+        : static_cast<unsigned>(opts.max_threads * n.cpus.size() / std::max<std::size_t>(total_cpus, 1));
+    workers = std::max(workers, 1u); // a node without workers couldn't run its tasks
+    assigned += workers;
+
+    auto node_opts = opts;
+    node_opts.max_threads = workers;
+    node_opts.cpus = n.cpus;
+    node_opts.on_idle = [this, i] { return steal(i); };
+    pools_.emplace_back(std::make_unique<threadpool>(node_opts));
+    ready_.store(static_cast<unsigned>(pools_.size()), std::memory_order_release);
+  }
+}
+
+numa_pool::~numa_pool() {
+  stop();
+}
+
+task_queue *numa_pool::steal(unsigned thief) noexcept {
+  // nodes still being built are skipped
+  const auto built = ready_.load(std::memory_order_acquire);
+  const auto n = static_cast<unsigned>(topology_.size());
+  for (unsigned i = 1; i < n; ++i) {
+    const auto victim = (thief + i) % n;
+    if (victim >= built)
+      continue;
+    if (auto q = pools_[victim]->servable_queue())
+      return q;
+  }
+  return nullptr;
+}
+
+unsigned numa_pool::current_node() const noexcept {
+  const auto cpu = ::sched_getcpu();
+  if (cpu < 0 || static_cast<unsigned>(cpu) >= cpu_node_.size())
+    return 0;
+  return cpu_node_[cpu];
+}
+
+void numa_pool::stop() {
+  ready_.store(0, std::memory_order_release);
+  for (auto &&p : pools_)
+    p->stop();
+}
+
+void numa_pool::shutdown() {
+  for (auto &&p : pools_)
+    p->shutdown();
+}
+
+} // namespace thp
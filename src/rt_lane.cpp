@@ -0,0 +1,72 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <latch>
+#include <sched.h>
+#include <stdexcept>
+#include <thread>
+
+#include "include/rt_lane.hpp"
+
+namespace thp {
+
+rt_lane::rt_lane(const rt_lane_options &opts)
+  : q_{}
+  , pool_{"rt_lane", opts.threads}
+  , threshold_{opts.threshold}
+  , realtime_{0}
+{
+  if (opts.threads == 0)
+    return;
+
+  // lane is ready once every worker has its scheduling policy
+  std::latch configured{opts.threads};
+  auto started = pool_.start([this, opts, &configured](managed_stop_token st) {
+    auto [_, me] = pool_.worker_info(std::this_thread::get_id()).value();
+    platform::thread_config rt;
+    rt.set_policy(SCHED_FIFO);
+    rt.set_priority(opts.os_priority);
+    if (!opts.cpus.empty())
+      rt.set_affinity(opts.cpus);
+    if (rt.apply(&me) == 0)
+      realtime_.fetch_add(1, std::memory_order_relaxed);
+    configured.count_down();
+    work(st);
+  });
+  configured.count_down(opts.threads - started.size());
+  configured.wait();
+  if (started.size() != opts.threads)
+    throw std::runtime_error("couldn't start rt lane workers, runtime error");
+}
+
+void rt_lane::work(managed_stop_token st) noexcept {
+  auto [idx, me] = pool_.worker_info(std::this_thread::get_id()).value();
+
+  while (st.current_state() != stop_source_state_t::stopped) {
+    if (st.current_state() == stop_source_state_t::paused) {
+      pool_.not_working(idx);
+      me.sleep(); // resume wakes us
+      continue;
+    }
+    q_.accept(me);
+    pool_.not_working(idx);
+    // recheck after publishing idle state, a pusher either sees us idle and
+    // wakes us, or we see its task here
+    if (q_.empty() || !pool_.claim(idx))
+      me.sleep();
+  }
+}
+
+} // namespace thp
@@ -31,55 +31,196 @@ limitations under the License.
 
 namespace thp {
 
-threadpool::threadpool(unsigned max_threads)
+threadpool::threadpool(unsigned max_threads, sch::names algo)
+  : threadpool(pool_options{.max_threads = max_threads, .algo = algo}) {}
+
+threadpool::threadpool(const pool_options &opts)
   : mu_{}
   , shutdown_cv_{}
   , idle_cond_{}
   , stop_src_{}
   , etc_stop_src_{}
+  , stopped_{false}
+  , inflight_{0}
   , jobq_{}
-  , cpu_pool_{"cpu_pool:0", max_threads}
-  , managers_{"schedulers", 1}
+  , cpu_pool_{"cpu_pool:0", opts.max_threads}
+  , managers_{"schedulers", 2}
+  , book_keepers_{"book_keepers", opts.elastic.min_threads > 0 && opts.elastic.min_threads < opts.max_threads}
   , scheduler_{nullptr}
+  , timer_{nullptr}
+  , timers_{}
   , stats_{}
-  , max_threads_{max_threads}
-  , tp_algo_{stats_, jobq_, cpu_pool_, managers_}
+  , max_threads_{opts.max_threads}
+  , dispatch_{opts.dispatch}
+  , overflow_{opts.on_overflow}
+  , tp_algo_{opts.algo, stats_, jobq_, cpu_pool_, managers_}
+  , rt_{opts.rt}
 {
   std::lock_guard l{mu_};
 
+  jobq_.add_tenants(opts.tenants);
+  jobq_.capacity(opts.queue_capacity);
   jobq_.init_stats(stats_);
-
-  auto workers = cpu_pool_.start([&](managed_stop_token st) { auto f = tp_algo_.worker_fn(); f(st); });
-  auto [tid] = managers_.run([&](managed_stop_token st) { auto f = tp_algo_.scheduler_fn(); f(st); });
-  if (workers.empty() or (tid == std::thread::id()))
+  jobq_.typed_queue_for<deadline_task>().on_miss(opts.on_deadline_miss);
+  if (!opts.queue_weights.empty() || !opts.tenants.empty()) {
+    auto weights = opts.queue_weights;
+    weights.resize(decltype(jobq_)::NumQs, 1);
+    for (unsigned i = 0; i < opts.tenants.size(); ++i) {
+      weights.push_back(opts.tenants[i].weight);
+      jobq_.tenant(tenant_id{i}).on_ready([this] { scheduler_->wakeup(); });
+    }
+    jobq_.fair_share(std::move(weights));
+  }
+
+  if (opts.on_idle)
+    cpu_pool_.on_idle([this, fn = opts.on_idle]() -> task_queue * {
+      // local tasks first, the scheduler hands them out
+      return servable_queue() ? nullptr : fn();
+    });
+
+  // worker i runs on pinned[i % n], without a pinning policy workers float
+  // over the pool's cpus
+  auto pinned = platform::pin_order(
+      opts.pinning, platform::cpu_topology(opts.cpus.empty() ? platform::allowed_cpus() : opts.cpus));
+
+  auto worker_fn = [this, cpus = opts.cpus, pinned](managed_stop_token st) {
+    auto [idx, me] = cpu_pool_.worker_info(std::this_thread::get_id()).value();
+    if (!pinned.empty() || !cpus.empty()) {
+      platform::thread_config pin;
+      if (!pinned.empty())
+        pin.set_affinity({pinned[idx % pinned.size()]});
+      else
+        pin.set_affinity(cpus);
+      pin.apply(&me);
+    }
+    helper ctx{*this, idx, me};
+    worker_context::scope in_pool{ctx};
+    auto f = tp_algo_.worker_fn();
+    f(st);
+  };
+  // an elastic pool starts small, its book keeper adds workers on demand
+  const bool elastic = book_keepers_.size() > 0;
+  auto workers = elastic ? cpu_pool_.start(worker_fn, opts.elastic.min_threads)
+                         : cpu_pool_.start(worker_fn);
+  auto [tid, timer_tid] = managers_.run([&](managed_stop_token st) { auto f = tp_algo_.scheduler_fn(); f(st); },
+                                        [this](managed_stop_token st) { run_timers(st); });
+  if (workers.empty() or (tid == std::thread::id()) or (timer_tid == std::thread::id()))
     throw std::runtime_error("couldn't start workers/managers, runtime error");
+  if (elastic) {
+    auto [kid] = book_keepers_.run([this, e = opts.elastic](managed_stop_token st) { resize_workers(st, e); });
+    if (kid == std::thread::id())
+      throw std::runtime_error("couldn't start book keeper, runtime error");
+  }
 
   auto [_, th] = managers_.worker_info(tid).value();
   scheduler_ = &th;
+  auto [__, tt] = managers_.worker_info(timer_tid).value();
+  timer_ = &tt;
 }
 
 void threadpool::shutdown() {
+  book_keepers_.shutdown();
   cpu_pool_.shutdown();
   managers_.shutdown();
 }
 
-void threadpool::pause() {
-	jobq_.close();
-	cpu_pool_.pause();
-	managers_.pause();
+void threadpool::drain() const noexcept {
+  // the last task out wakes us, counts in between don't
+  for (auto n = inflight_.load(std::memory_order_acquire); n != 0;
+       n = inflight_.load(std::memory_order_acquire))
+    inflight_.wait(n, std::memory_order_acquire);
 }
 
-void threadpool::resume() {
-  managers_.resume();
+void threadpool::pause() noexcept {
+  managers_.pause();
+  cpu_pool_.pause();
+  rt_.pause();
+}
+
+void threadpool::resume() noexcept {
+  rt_.resume();
   cpu_pool_.resume();
+  managers_.resume();
 }
 
 void threadpool::stop() {
+  stopped_.store(true, std::memory_order_release);
+  rt_.stop();
   jobq_.close();  
   jobq_.stop();
   shutdown();
 }
 
+// backs off with growing timed parks while there is nothing to run, a
+// wakeup consumed meanwhile belongs to the worker loop and is passed on
+void threadpool::helper::help(done_fn done, const void *arg) noexcept {
+  std::chrono::nanoseconds pause = std::chrono::microseconds(1);
+  bool woken = false;
+  while (!done(arg)) {
+    if (tp_.tp_algo_.help_one(idx_, me_)) {
+      pause = std::chrono::microseconds(1);
+      continue;
+    }
+    woken |= me_.sleep_for(pause);
+    pause = std::min<std::chrono::nanoseconds>(2 * pause, configs::help_park_limit());
+  }
+  if (woken)
+    me_.wakeup();
+}
+
+// sleeps till the next occupied slot of the wheel, or till a new timer
+// is due earlier, and queues all timers expired by then as one batch
+void threadpool::run_timers(managed_stop_token st) {
+  auto [_, me] = managers_.worker_info(std::this_thread::get_id()).value();
+  std::vector<std::shared_ptr<ds::timer_node>> expired;
+  std::vector<simple_task> batch;
+
+  while (st.current_state() != stop_source_state_t::stopped) {
+    const auto now = std::chrono::steady_clock::now();
+    const auto next = timers_.advance(timers_.ticks_at(now), expired);
+    if (!expired.empty()) {
+      for (auto &&n : expired)
+        batch.emplace_back([n = std::move(n)] { n->fire(); }).track(inflight_);
+      expired.clear();
+      const auto n = batch.size();
+      jobq_.schedule_task(std::move(batch));
+      batch.clear();
+      wake_workers(n, jobq_.template queue_for<simple_task>());
+    }
+
+    if (next == ds::timer_wheel::Never)
+      me.sleep();
+    else
+      me.sleep_for(timers_.time_of(next) - now);
+  }
+}
+
+// samples queue depth and worker usage into stats_ every tick and lets
+// the sizer turn them into workers to start or retire
+void threadpool::resize_workers(managed_stop_token st, const elastic_options &opts) {
+  auto [_, me] = book_keepers_.worker_info(std::this_thread::get_id()).value();
+  algos::elastic_sizer sizer{opts, max_threads_};
+
+  while (st.current_state() != stop_source_state_t::stopped) {
+    me.sleep_for(configs::elastic_tick());
+
+    // tasks held back by a tenant quota need no workers
+    std::size_t depth = 0;
+    for (auto q : stats_.jobq.in.qs)
+      depth += q->servable_size();
+    const auto running = cpu_pool_.running();
+    stats_.ts = std::chrono::system_clock::now();
+    stats_.jobq.in.num_tasks = static_cast<std::uint32_t>(depth);
+    stats_.pool.num_threads = static_cast<std::uint16_t>(running);
+    stats_.pool.num_workers = static_cast<std::uint16_t>(running - std::min(cpu_pool_.idle(), running));
+
+    if (const auto n = sizer.resize(stats_); n > 0)
+      cpu_pool_.grow(static_cast<unsigned>(n));
+    else if (n < 0)
+      cpu_pool_.retire_idle(static_cast<unsigned>(-n));
+  }
+}
+
 threadpool::~threadpool() {
   std::call_once(del_flag_, [&] { stop(); });
 }
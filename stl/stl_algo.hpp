@@ -23,6 +23,7 @@ limitations under the License.
 
 #include "include/threadpool.hpp"
 #include "include/partitioner.hpp"
+#include "include/task_graph.hpp"
 #include "include/algos/partitioner/equal_size.hpp"
 
 namespace thp {
@@ -40,51 +41,46 @@ public:
             typename Proj = std::identity>
     requires std::sortable<I, Comp, Proj>
     constexpr decltype(auto) sort(I start, S end, Comp cmp = {}, Proj prj = {}) {
-      using RangeData = std::ranges::subrange<I, S>;
-      using Ret = std::tuple<I, S>;
-      using tp_sort_func = std::function<Ret(RangeData, Comp, Proj)>;
-
-      tp_sort_func tp_sort = [&](RangeData data, Comp cmp, Proj prj) {
-        const auto len = std::ranges::size(data);
-        if (len <= configs::stl_sort_cutoff()) {
-          std::ranges::sort(data, cmp, prj);
-        } else {
-          // level merge of sorted ranges
-          auto level_merge_func = [this](auto&& fut_vec) mutable
-          {
-            auto one_merge = [](auto&& f1, auto&& f2) mutable {
-                auto [s1, e1] = f1.get();
-                auto [s2, e2] = f2.get();
-                //assert(e1 == s2);
-                std::ranges::inplace_merge(s1, s2, e2);
-                return std::make_tuple(s1, e2);
-            };
-
-            std::vector<std::future<Ret>> futs;
-            const auto m = fut_vec.size()/2;
-            for(unsigned i = 0; i < 2*m; i += 2) {
-              auto f1 = std::move(fut_vec[i]);
-              auto f2 = std::move(fut_vec[i+1]);
-              futs.emplace_back(__impl_tp.submit(one_merge, std::move(f1), std::move(f2)));
-            }
-            if (fut_vec.size()%2 != 0) futs.emplace_back(std::move(fut_vec.back()));
-            return futs;
-          };
-
-          std::vector<std::future<Ret>> futs;
-          algos::partitioner::equal_size<I,S> algo(configs::stl_sort_cutoff(), data.begin(), data.end());
-          partitioner chunks(algo);
-          for(auto&& sr : chunks)
-            futs.emplace_back(__impl_tp.submit(tp_sort, sr, cmp, prj));
-
-          while (futs.size() > 1) {
-            futs = level_merge_func(std::move(futs));
-          }
-          futs.front().wait();
+      const auto len = std::ranges::distance(start, end);
+      if (len <= configs::stl_sort_cutoff()) {
+        std::ranges::sort(start, end, cmp, prj);
+        return std::make_tuple(start, end);
+      }
+
+      // chunks are sorted by leaf nodes, each merge node waits on the two
+      // nodes below it. a merge is queued only once both halves are sorted,
+      // no worker blocks on a partial result
+      struct sorted_run { I s, e; task_graph::node_id id; };
+
+      task_graph g;
+      std::vector<sorted_run> level;
+      algos::partitioner::equal_size<I,S> algo(configs::stl_sort_cutoff(), start, end);
+      partitioner chunks(algo);
+      for(auto&& sr : chunks) {
+        auto id = g.emplace([s = sr.begin(), e = sr.end(), cmp, prj] {
+          std::ranges::sort(s, e, cmp, prj);
+        });
+        level.push_back({sr.begin(), sr.end(), id});
+      }
+
+      while (level.size() > 1) {
+        std::vector<sorted_run> next;
+        for (std::size_t i = 0; i + 1 < level.size(); i += 2) {
+          const auto &a = level[i], &b = level[i+1];
+          auto id = g.emplace([s = a.s, m = b.s, e = b.e, cmp, prj] {
+            std::ranges::inplace_merge(s, m, e, cmp, prj);
+          });
+          g.precede(a.id, id);
+          g.precede(b.id, id);
+          next.push_back({a.s, b.e, id});
         }
-        return std::make_tuple(data.begin(), data.end());
-      };
-      return tp_sort(RangeData(FWD(start), FWD(end)), cmp, prj);
+        if (level.size() % 2 != 0) next.push_back(level.back());
+        level = std::move(next);
+      }
+
+      g.run(__impl_tp);
+      g.wait();
+      return std::make_tuple(start, end);
     }
 
   template <
@@ -95,33 +91,29 @@ public:
     typename ParitionAlgo = algos::partitioner::equal_size<I,S>
   >
   requires std::movable<T>
-  constexpr decltype(auto) transform_reduce(I s, S e,
+  constexpr decltype(auto) transform_reduce(I /*s*/, S /*e*/,
                                   T init,
                                   BinaryOp rdc_fn, UnaryOp tr_fn,
                                   ParitionAlgo algo) {
     auto transform_reduce_fn = [=](auto&& subrng) {
       return std::transform_reduce(subrng.begin(), subrng.end(), init, rdc_fn, tr_fn);
     };
-    // schedule subranges
-    auto f = __impl_tp.submit([=, this] () mutable {
-        std::vector<std::future<T>> futs;
-        partitioner partitions(algo);
-        for(auto&& sr : partitions) {
-          futs.emplace_back(__impl_tp.submit(transform_reduce_fn, sr));
-        }
-        return futs;
-      }
-    );
-    // accumulate
-    return __impl_tp.submit([=] (auto&& futs) mutable {
-      return std::transform_reduce(futs.begin(), futs.end(), init, rdc_fn,
+    // schedule subranges, accumulate once all of them are done.
+    // caller doesn't block
+    std::vector<future<T>> futs;
+    partitioner partitions(algo);
+    for(auto&& sr : partitions) {
+      futs.emplace_back(__impl_tp.submit(transform_reduce_fn, sr));
+    }
+    return util::when_all(std::move(futs)).then([=] (std::vector<future<T>> done) mutable {
+      return std::transform_reduce(done.begin(), done.end(), init, rdc_fn,
                [](auto&& fut) mutable { return fut.get(); });
-      }, std::move(f.get()));
+      });
   }
 
   template<std::input_iterator I, std::sentinel_for<I> S, typename Fn>
   constexpr decltype(auto) for_each(I s, S e, Fn fn) {
-    return std::ranges::for_each(s, e, [fn, this](auto&& x) { return __impl_tp.submit(fn, x); });
+    return __impl_tp.submit_bulk(fn, std::ranges::subrange(s, e));
   }
 
   // parallel algorithm, for benchmarks see examples/reduce.cpp
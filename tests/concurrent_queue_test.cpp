@@ -0,0 +1,348 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <iterator>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "include/atomic_bitmap.hpp"
+#include "include/chase_lev_deque.hpp"
+#include "include/mpmc_queue.hpp"
+#include "include/multi_queue.hpp"
+#include "include/slab_allocator.hpp"
+#include "include/task_factory.hpp"
+#include "include/timer_wheel.hpp"
+#include "platform/eventcount.hpp"
+
+namespace {
+
+using namespace std;
+
+TEST(ChaseLevDeque, owner_lifo) {
+  thp::ds::chase_lev_deque<int> q(2);
+  for (int i = 0; i < 10; ++i)
+    q.push(make_unique<int>(i));
+
+  EXPECT_EQ(q.size(), 10u);
+  auto s = q.steal();
+  ASSERT_TRUE(s);
+  EXPECT_EQ(*s, 0);
+
+  for (int i = 9; i > 0; --i) {
+    auto x = q.pop();
+    ASSERT_TRUE(x);
+    EXPECT_EQ(*x, i);
+  }
+  EXPECT_FALSE(q.pop());
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(ChaseLevDeque, concurrent_steal) {
+  constexpr int N = 100000;
+  thp::ds::chase_lev_deque<int> q;
+  atomic<long> sum{0};
+  atomic<int> taken{0};
+
+  vector<jthread> thieves;
+  for (int i = 0; i < 3; ++i) {
+    thieves.emplace_back([&] {
+      while (taken.load() < N) {
+        if (auto x = q.steal()) {
+          sum += *x;
+          ++taken;
+        }
+      }
+    });
+  }
+
+  for (int i = 0; i < N; ++i) {
+    q.push(make_unique<int>(i));
+    if (i % 3 == 0) {
+      if (auto x = q.pop()) {
+        sum += *x;
+        ++taken;
+      }
+    }
+  }
+  while (taken.load() < N) {
+    if (auto x = q.pop()) {
+      sum += *x;
+      ++taken;
+    }
+  }
+  thieves.clear();
+
+  EXPECT_EQ(sum.load(), long(N) * (N - 1) / 2);
+}
+
+TEST(MpmcRing, bounded_fifo) {
+  thp::ds::mpmc_ring<int> q(4);
+  EXPECT_EQ(q.capacity(), 4u);
+  for (int i = 0; i < 4; ++i) {
+    int x = i;
+    EXPECT_TRUE(q.try_push(x));
+  }
+  int y = 42;
+  EXPECT_FALSE(q.try_push(y));
+  EXPECT_EQ(y, 42);
+
+  for (int i = 0; i < 4; ++i)
+    EXPECT_EQ(q.try_pop().value(), i);
+  EXPECT_FALSE(q.try_pop());
+}
+
+TEST(MpmcRing, concurrent_producers_consumers) {
+  constexpr int N = 50000, P = 3, C = 3;
+  thp::ds::mpmc_ring<int> q(1024);
+  atomic<long> sum{0};
+  atomic<int> popped{0};
+  {
+    vector<jthread> ths;
+    for (int p = 0; p < P; ++p)
+      ths.emplace_back([&] {
+        for (int i = 0; i < N; ++i) {
+          int x = i;
+          while (!q.try_push(x)) this_thread::yield();
+        }
+      });
+    for (int c = 0; c < C; ++c)
+      ths.emplace_back([&] {
+        while (popped.load() < N * P) {
+          if (auto x = q.try_pop()) {
+            sum += *x;
+            ++popped;
+          }
+        }
+      });
+  }
+  EXPECT_EQ(sum.load(), long(P) * N * (N - 1) / 2);
+}
+
+TEST(MpmcWorkQueue, spills_beyond_capacity) {
+  thp::ds::mpmc_workq<thp::simple_task> q(4);
+  int runs = 0;
+  for (int i = 0; i < 10; ++i)
+    q.push(thp::make_task([&runs] { ++runs; }));
+
+  EXPECT_EQ(q.size(), 10u);
+  while (auto t = q.pop())
+    t->execute();
+
+  EXPECT_EQ(runs, 10);
+  EXPECT_TRUE(q.empty());
+
+  // batch insert keeps fifo order across ring and overflow
+  vector<int> order;
+  vector<thp::simple_task> batch;
+  for (int i = 0; i < 10; ++i)
+    batch.emplace_back(thp::make_task([&order, i] { order.push_back(i); }));
+  q.insert(make_move_iterator(batch.begin()), make_move_iterator(batch.end()));
+
+  EXPECT_EQ(q.size(), 10u);
+  while (auto t = q.pop())
+    t->execute();
+  EXPECT_TRUE(std::ranges::is_sorted(order));
+  EXPECT_EQ(order.size(), 10u);
+}
+
+unsigned identity(unsigned n) { return n; }
+
+TEST(MultiQueue, relaxed_order) {
+  using task_t = thp::priority_task<int>;
+  thp::ds::multi_workq<task_t, std::less<task_t>> q(4);
+  constexpr int N = 1000;
+  for (int i = 0; i < N; ++i)
+    q.push(move(thp::make_task<int>(identity, i).priority(i)));
+
+  EXPECT_EQ(q.size(), size_t(N));
+
+  // with 4 heaps every pop is among the top few elements
+  int prev_max = N, popped = 0;
+  while (auto t = q.pop()) {
+    EXPECT_GT(t->priority(), prev_max - 64);
+    prev_max = min(prev_max, t->priority());
+    ++popped;
+  }
+  EXPECT_EQ(popped, N);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(AtomicBitmap, beyond_one_word) {
+  thp::ds::atomic_bitmap bm(1000);
+  EXPECT_TRUE(bm.none());
+  EXPECT_FALSE(bm.acquire_any());
+
+  bm.set(999);
+  bm.set(70);
+  bm.set(3);
+  EXPECT_TRUE(bm.test(70));
+  EXPECT_EQ(bm.acquire_any().value(), 3u);
+  EXPECT_EQ(bm.acquire_any().value(), 70u);
+  EXPECT_FALSE(bm.reset(70));
+  EXPECT_EQ(bm.wait_acquire_any(), 999u);
+  EXPECT_TRUE(bm.none());
+
+  EXPECT_THROW(thp::ds::atomic_bitmap(thp::ds::atomic_bitmap::MaxBits + 1), std::logic_error);
+}
+
+TEST(AtomicBitmap, concurrent_set_acquire) {
+  constexpr unsigned N = 4096;
+  thp::ds::atomic_bitmap bm(N);
+  vector<atomic<int>> owned(N);
+  {
+    vector<jthread> ths;
+    for (int t = 0; t < 4; ++t)
+      ths.emplace_back([&, t] {
+        for (unsigned i = t; i < N; i += 4)
+          bm.set(i);
+        for (int k = 0; k < 20000; ++k) {
+          if (auto idx = bm.acquire_any()) {
+            EXPECT_EQ(owned[*idx]++, 0);
+            owned[*idx]--;
+            bm.set(*idx);
+          }
+        }
+      });
+  }
+  unsigned n = 0;
+  while (bm.acquire_any()) ++n;
+  EXPECT_EQ(n, N);
+}
+
+TEST(Parker, permit_and_timeout) {
+  using namespace std::chrono_literals;
+  thp::platform::parker p;
+
+  EXPECT_FALSE(p.try_park());
+  EXPECT_FALSE(p.park_for(1ms));
+
+  // permits do not accumulate
+  p.unpark();
+  p.unpark();
+  EXPECT_TRUE(p.park_for(1ms));
+  EXPECT_FALSE(p.try_park());
+
+  atomic<int> rounds{0};
+  jthread waker([&] {
+    for (int i = 0; i < 1000; ++i) {
+      while (rounds.load() != i) this_thread::yield();
+      p.unpark();
+    }
+  });
+  for (int i = 0; i < 1000; ++i) {
+    rounds.store(i);
+    p.park();
+  }
+}
+
+TEST(EventCount, wakes_waiter) {
+  thp::platform::event_count ec;
+  atomic<int> ready{0};
+
+  jthread waiter([&] {
+    while (true) {
+      if (ready.load()) return;
+      auto key = ec.prepare_wait();
+      if (ready.load()) {
+        ec.cancel_wait();
+        return;
+      }
+      ec.wait(key);
+    }
+  });
+  this_thread::sleep_for(1ms);
+  ready.store(1);
+  ec.notify_one();
+}
+
+TEST(Slab, reuse_and_remote_free) {
+  using block_t = array<int, 10>;
+  auto a = thp::ds::make_slab<block_t>();
+  auto *raw = a.get();
+  a.reset();
+  // freed on owner thread, next allocation reuses it
+  auto b = thp::ds::make_slab<block_t>();
+  EXPECT_EQ(b.get(), raw);
+
+  // blocks freed by another thread come back to this thread's cache
+  constexpr int N = 1000;
+  vector<thp::ds::slab_ptr<block_t>> blocks;
+  for (int i = 0; i < N; ++i)
+    blocks.emplace_back(thp::ds::make_slab<block_t>())->at(0) = i;
+  for (int i = 0; i < N; ++i)
+    EXPECT_EQ(blocks[i]->at(0), i);
+  thread([&] { blocks.clear(); }).join();
+
+  vector<thp::ds::slab_ptr<block_t>> again;
+  for (int i = 0; i < N; ++i)
+    again.emplace_back(thp::ds::make_slab<block_t>());
+  EXPECT_EQ(again.size(), size_t(N));
+}
+
+TEST(TimerWheel, fires_at_expiry_across_levels) {
+  using namespace std::chrono_literals;
+  const auto epoch = thp::ds::timer_wheel::clock::now();
+  thp::ds::timer_wheel wheel(1ms, epoch);
+  mt19937_64 rnd{7};
+
+  constexpr int N = 5000;
+  vector<uint64_t> due(N), fired_at(N, 0);
+  vector<thp::timer> timers;
+  bool woken = false;
+  for (int i = 0; i < N; ++i) {
+    due[i] = 1 + rnd() % (1u << 20);
+    timers.push_back(wheel.add(wheel.time_of(due[i]), {}, [&fired_at, i] { ++fired_at[i]; }, woken));
+  }
+  // every 7th is cancelled
+  for (int i = 0; i < N; i += 7)
+    EXPECT_TRUE(timers[i].cancel());
+  EXPECT_FALSE(timers[0].cancel());
+
+  vector<shared_ptr<thp::ds::timer_node>> out;
+  for (uint64_t to = 0; to < (1u << 20) + 5000; to += 1 + rnd() % 5000) {
+    wheel.advance(to, out);
+    for (auto &&n : out)
+      n->fire();
+    out.clear();
+    for (int i = 0; i < N; ++i)
+      ASSERT_EQ(fired_at[i], (i % 7 != 0 && due[i] <= to) ? 1u : 0u) << i << " due " << due[i] << " at " << to;
+  }
+  EXPECT_EQ(wheel.size(), 0u);
+}
+
+TEST(TimerWheel, cancel_skips_queued_fire) {
+  using namespace std::chrono_literals;
+  const auto epoch = thp::ds::timer_wheel::clock::now();
+  thp::ds::timer_wheel wheel(1ms, epoch);
+  int fired = 0;
+  bool woken = false;
+  auto every = wheel.add(wheel.time_of(1), 1ms, [&fired] { ++fired; }, woken);
+
+  // expired and linked again for its next period, but not run yet
+  vector<shared_ptr<thp::ds::timer_node>> out;
+  wheel.advance(1, out);
+  ASSERT_EQ(out.size(), 1u);
+  EXPECT_TRUE(every.cancel());
+  out.front()->fire();
+  EXPECT_EQ(fired, 0);
+  EXPECT_EQ(wheel.size(), 0u);
+}
+
+} // namespace
@@ -1,5 +1,6 @@
 #include "gtest/gtest.h"
 #include "include/coroutine/task.hpp"
+#include "include/threadpool.hpp"
 
 namespace {
 
@@ -27,4 +28,37 @@ TEST(CoroutineTasks, single_call) {
   EXPECT_EQ(t(), 42);
 }
 
+thp::coro::pool_task<int> square_on(thp::threadpool &tp, int x) {
+  co_await tp.schedule();
+  co_return x * x;
+}
+
+thp::coro::pool_task<int> handler(thp::threadpool &tp, int x, std::thread::id caller) {
+  co_await tp.schedule();
+  EXPECT_NE(std::this_thread::get_id(), caller);
+  auto doubled = co_await tp.submit([x] { return 2 * x; });
+  co_return doubled + co_await square_on(tp, x);
+}
+
+thp::coro::pool_task<void> fails(thp::threadpool &tp) {
+  co_await tp.schedule();
+  throw std::runtime_error("handler");
+}
+
+TEST(CoroutineTasks, resume_on_pool) {
+  thp::threadpool tp(4);
+  const auto caller = std::this_thread::get_id();
+
+  std::vector<thp::future<int>> futs;
+  for (int i = 0; i < 1000; ++i)
+    futs.emplace_back(tp.spawn(handler(tp, i, caller)));
+
+  int i = 0;
+  for (auto &&f : thp::util::when_all(std::move(futs)).get()) {
+    EXPECT_EQ(f.get(), 2 * i + i * i);
+    ++i;
+  }
+  EXPECT_THROW(tp.spawn(fails(tp)).get(), std::runtime_error);
+}
+
 }
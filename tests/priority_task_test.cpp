@@ -13,9 +13,12 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <array>
 #include <chrono>
+#include <memory>
 
 #include "gtest/gtest.h"
+#include "include/fixed_function.hpp"
 #include "include/task_type.hpp"
 #include "include/task_queue.hpp"
 #include "include/task_factory.hpp"
@@ -68,6 +71,32 @@ TEST(WorkQueue, order) {
   }
 }
 
+TEST(FixedFunction, inline_and_heap) {
+  using fn_t = thp::fixed_function<int(int), 64>;
+  static_assert(sizeof(fn_t) == 64);
+
+  int base = 10;
+  fn_t small = [base](int x) { return base + x; };
+  EXPECT_EQ(small(1), 11);
+  static_assert(fn_t::fits_inline<decltype([base](int x) { return base + x; })>);
+
+  array<char, 128> big{};
+  big[0] = 5;
+  auto large_lambda = [big](int x) { return big[0] + x; };
+  static_assert(!fn_t::fits_inline<decltype(large_lambda)>);
+  fn_t large = large_lambda;
+  EXPECT_EQ(large(1), 6);
+
+  auto owned = make_unique<int>(7);
+  fn_t move_only = [p = move(owned)](int x) { return *p + x; };
+  fn_t moved = move(move_only);
+  EXPECT_FALSE(move_only);
+  EXPECT_EQ(moved(1), 8);
+
+  moved = move(large);
+  EXPECT_EQ(moved(2), 7);
+}
+
 // TEST(PriorityTaskTest, qorder) {
 //   auto t1 = thp::simple_task<int>(factorial, 1);
 //   auto t2 = thp::simple_task<int>(factorial, 2);
@@ -0,0 +1,784 @@
+/* Copyright 2021 Threadpool Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <atomic>
+#include <ctime>
+#include <future>
+#include <latch>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <ranges>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "include/numa_pool.hpp"
+#include "include/task_graph.hpp"
+#include "include/threadpool.hpp"
+
+namespace {
+
+using namespace std;
+
+long sum_of_squares(thp::threadpool &tp, int n) {
+  vector<thp::future<long>> futs;
+  futs.reserve(n);
+  for (int i = 0; i < n; ++i)
+    futs.emplace_back(tp.submit([](long x) { return x * x; }, i));
+
+  long total = 0;
+  for (auto &&f : futs)
+    total += f.get();
+  return total;
+}
+
+// polls cond till it holds, for 5s at most
+template <typename Cond>
+bool eventually(Cond cond) {
+  using namespace std::chrono_literals;
+  for (auto end = chrono::steady_clock::now() + 5s; !cond() && chrono::steady_clock::now() < end;)
+    this_thread::sleep_for(1ms);
+  return cond();
+}
+
+class DispatchTest : public ::testing::TestWithParam<tuple<thp::sch::names, thp::dispatch_mode>> {};
+
+TEST_P(DispatchTest, runs_all_tasks) {
+  auto [algo, dispatch] = GetParam();
+  thp::threadpool tp(thp::pool_options{.max_threads = 4, .algo = algo, .dispatch = dispatch});
+
+  constexpr int n = 2000;
+  EXPECT_EQ(sum_of_squares(tp, n), long(n - 1) * n * (2 * n - 1) / 6);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    ThreadPool, DispatchTest,
+    ::testing::Combine(::testing::Values(thp::sch::eOneshot, thp::sch::eWaiting,
+                                         thp::sch::eWorkStealing),
+                       ::testing::Values(thp::dispatch_mode::eScheduler,
+                                         thp::dispatch_mode::eDirect)));
+
+TEST(ThreadPool, submit_bulk) {
+  thp::threadpool tp(4);
+
+  auto fut = tp.submit_bulk([](int x) { return x * x; }, std::views::iota(0, 1000));
+  EXPECT_EQ(fut.size(), 1000u);
+  auto squares = fut.get();
+  ASSERT_EQ(squares.size(), 1000u);
+  for (int i = 0; i < 1000; ++i)
+    EXPECT_EQ(squares[i], i * i);
+
+  atomic<int> ran{0};
+  auto failed = tp.submit_bulk([&ran](int x) {
+    ++ran;
+    if (x == 7) throw std::runtime_error("seven");
+  }, vector<int>{1, 7, 9});
+  EXPECT_THROW(failed.get(), std::runtime_error);
+  EXPECT_EQ(ran.load(), 3);
+}
+
+TEST(Future, promise_and_errors) {
+  thp::promise<int> p;
+  auto f = p.get_future();
+  EXPECT_THROW(p.get_future(), std::future_error);
+  EXPECT_FALSE(f.ready());
+  p.set_value(42);
+  EXPECT_TRUE(f.ready());
+  EXPECT_EQ(f.get(), 42);
+  EXPECT_FALSE(f.valid());
+
+  thp::future<void> broken;
+  {
+    thp::promise<void> q;
+    broken = q.get_future();
+  }
+  EXPECT_THROW(broken.get(), std::future_error);
+
+  thp::threadpool tp(2);
+  auto err = tp.submit([] { throw std::runtime_error("task"); });
+  EXPECT_THROW(err.get(), std::runtime_error);
+  auto s = tp.submit([](string a, const string &b) { return a + b; }, string("ab"), string("cd"));
+  EXPECT_EQ(s.get(), "abcd");
+}
+
+TEST(Future, then_runs_on_pool) {
+  thp::threadpool tp(2);
+  const auto caller = this_thread::get_id();
+
+  auto f = tp.submit([] { return 20; })
+               .then([](int x) { return x + 1; })
+               .then([caller](int x) {
+                 EXPECT_NE(this_thread::get_id(), caller);
+                 return to_string(x * 2);
+               });
+  EXPECT_EQ(f.get(), "42");
+
+  // a generic lambda gets the value
+  auto generic = tp.submit([] { return 1; }).then([](auto x) { return x + 1; });
+  EXPECT_EQ(generic.get(), 2);
+
+  // failure skips value continuations, reaches the ones taking a future
+  auto g = tp.submit([]() -> int { throw std::runtime_error("first"); })
+               .then([](int x) { return x + 1; })
+               .then([](thp::future<int> r) {
+                 try {
+                   return r.get();
+                 } catch (std::runtime_error &) {
+                   return -1;
+                 }
+               });
+  EXPECT_EQ(g.get(), -1);
+
+  // chained on a plain promise, runs on the thread setting the value
+  thp::promise<void> p;
+  atomic<bool> ran{false};
+  auto h = p.get_future().then([&ran] { ran = true; });
+  EXPECT_FALSE(ran.load());
+  p.set_value();
+  EXPECT_TRUE(ran.load());
+  h.get();
+}
+
+TEST(Future, when_all_and_when_any) {
+  thp::threadpool tp(4);
+  vector<thp::future<int>> futs;
+  for (int i = 0; i < 200; ++i)
+    futs.emplace_back(tp.submit([i] { return i; }));
+
+  auto sum = thp::util::when_all(futs.begin(), futs.end())
+                 .then([](vector<thp::future<int>> done) {
+                   int s = 0;
+                   for (auto &f : done) {
+                     EXPECT_TRUE(f.ready());
+                     s += f.get();
+                   }
+                   return s;
+                 });
+  EXPECT_EQ(sum.get(), 199 * 200 / 2);
+  EXPECT_TRUE(thp::util::when_all(vector<thp::future<int>>{}).get().empty());
+
+  auto [a, b] = thp::util::when_all(tp.submit([] { return 1; }),
+                                    tp.submit([] { return string("x"); }))
+                    .get();
+  EXPECT_EQ(a.get(), 1);
+  EXPECT_EQ(b.get(), "x");
+
+  thp::promise<int> never;
+  auto any = thp::util::when_any(never.get_future(), tp.submit([] { return 7; })).get();
+  EXPECT_EQ(any.index, 1u);
+  EXPECT_EQ(get<1>(any.futures).get(), 7);
+  never.set_value(0);
+  EXPECT_EQ(get<0>(any.futures).get(), 0);
+
+  // a loser can be chained once there is a winner
+  thp::promise<int> late;
+  auto first = thp::util::when_any(late.get_future(), tp.submit([] { return 1; })).get();
+  auto chained = std::move(get<0>(first.futures)).then([](int x) { return x + 1; });
+  late.set_value(41);
+  EXPECT_EQ(chained.get(), 42);
+}
+
+TEST(TaskGraph, runs_in_dependency_order_and_reruns) {
+  thp::threadpool tp(4);
+  thp::task_graph g;
+  vector<int> order(4, -1);
+  atomic<int> tick{0};
+
+  // diamond a -> {b, c} -> d
+  auto a = g.emplace([&] { order[0] = tick++; });
+  auto b = g.emplace([&] { order[1] = tick++; });
+  auto c = g.emplace([&] { order[2] = tick++; });
+  auto d = g.emplace([&] { order[3] = tick++; });
+  g.precede(a, b);
+  g.precede(a, c);
+  g.precede(b, d);
+  g.precede(c, d);
+
+  for (int run = 0; run < 100; ++run) {
+    tick = 0;
+    g.run(tp);
+    g.wait();
+    EXPECT_EQ(order[0], 0);
+    EXPECT_EQ(order[3], 3);
+    EXPECT_NE(order[1], order[2]);
+  }
+
+  // failure skips remaining nodes and is reported by wait
+  atomic<bool> after{false};
+  thp::task_graph h;
+  auto x = h.emplace([] { throw std::runtime_error("node"); });
+  auto y = h.emplace([&] { after = true; });
+  h.precede(x, y);
+  h.run(tp);
+  EXPECT_THROW(h.wait(), std::runtime_error);
+  EXPECT_FALSE(after.load());
+  EXPECT_THROW(h.precede(x, x), std::invalid_argument);
+
+  // destroyed right after wait(), while the last node may still be leaving
+  for (int i = 0; i < 200; ++i) {
+    thp::task_graph short_lived;
+    short_lived.precede(short_lived.emplace([] {}), short_lived.emplace([] {}));
+    short_lived.run(tp);
+    short_lived.wait();
+  }
+}
+
+TEST(ThreadPool, nested_wait_helps) {
+  for (auto algo : {thp::sch::eOneshot, thp::sch::eWaiting, thp::sch::eWorkStealing}) {
+    // one worker, waits inside tasks would deadlock without helping
+    thp::threadpool tp(1, algo);
+    auto outer = tp.submit([&tp] {
+      vector<thp::future<int>> inner;
+      for (int i = 0; i < 64; ++i)
+        inner.emplace_back(tp.submit([i] { return i; }));
+      int s = 0;
+      for (auto &f : inner)
+        s += f.get();
+      return s;
+    });
+    EXPECT_EQ(outer.get(), 63 * 64 / 2) << "algo " << static_cast<int>(algo);
+  }
+}
+
+TEST(NumaPool, topology_and_hints) {
+  EXPECT_EQ(thp::platform::parse_cpulist("0-3,8,10-11\n"),
+            (vector<unsigned>{0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_TRUE(thp::platform::parse_cpulist("x,").empty());
+  EXPECT_FALSE(thp::platform::numa_topology().empty());
+
+  // two nodes sharing cpu 0, runs anywhere
+  thp::numa_pool tp(thp::pool_options{.max_threads = 4},
+                    {{0, {0}}, {1, {0}}});
+  EXPECT_EQ(tp.nodes(), 2u);
+
+  vector<thp::future<int>> futs;
+  for (int i = 0; i < 100; ++i)
+    futs.emplace_back(i % 2 ? tp.submit([i] { return i; })
+                            : tp.submit(thp::on_node{1}, [i] { return i; }));
+  futs.emplace_back(tp.node(1).submit([] { return 0; }));
+
+  int sum = 0;
+  for (auto &f : thp::util::when_all(std::move(futs)).get())
+    sum += f.get();
+  EXPECT_EQ(sum, 99 * 100 / 2);
+
+  // more nodes than max_threads, one worker per node
+  thp::numa_pool small(thp::pool_options{.max_threads = 1}, {{0, {0}}, {1, {0}}, {2, {0}}});
+  for (unsigned n = 0; n < small.nodes(); ++n)
+    EXPECT_EQ(small.node(n).running_workers(), 1u);
+  EXPECT_EQ(small.submit(thp::on_node{2}, [] { return 2; }).get(), 2);
+
+  // a task queued on a busy node is taken by a node running out of work
+  for (auto algo : {thp::sch::eOneshot, thp::sch::eWaiting, thp::sch::eWorkStealing}) {
+    thp::numa_pool two(thp::pool_options{.max_threads = 2, .algo = algo}, {{0, {0}}, {1, {0}}});
+    atomic<bool> go_a{false}, go_b{false};
+    atomic<int> started{0};
+    auto block = [&started](atomic<bool> &go) {
+      ++started;
+      go.wait(false);
+      return this_thread::get_id();
+    };
+    // one blocker per node, whichever nodes they land on
+    auto a = two.submit([&] { return block(go_a); });
+    while (started < 1)
+      this_thread::yield();
+    auto b = two.submit([&] { return block(go_b); });
+    while (started < 2)
+      this_thread::yield();
+
+    // both nodes are busy, each queues its task. the worker released first
+    // runs its own and takes the other node's
+    auto on0 = two.submit(thp::on_node{0}, [] { return this_thread::get_id(); });
+    auto on1 = two.submit(thp::on_node{1}, [] { return this_thread::get_id(); });
+    go_a = true;
+    go_a.notify_all();
+    const auto thief = a.get();
+    EXPECT_TRUE(eventually([&] { return on0.ready() && on1.ready(); })) << "algo " << static_cast<int>(algo);
+    go_b = true;
+    go_b.notify_all();
+    EXPECT_NE(b.get(), thief) << "algo " << static_cast<int>(algo);
+    EXPECT_EQ(on0.get(), thief) << "algo " << static_cast<int>(algo);
+    EXPECT_EQ(on1.get(), thief) << "algo " << static_cast<int>(algo);
+  }
+}
+
+TEST(WorkerPool, start_copies_fn_per_worker) {
+  thp::worker_pool<thp::worker> pool("copies", 4);
+  std::mutex mu;
+  vector<size_t> sizes;
+  auto ids = pool.start([&mu, &sizes, v = vector<unsigned>{1, 2, 3}](thp::managed_stop_token) {
+    std::lock_guard l{mu};
+    sizes.push_back(v.size());
+  });
+  pool.shutdown();
+  EXPECT_EQ(ids.size(), 4u);
+  EXPECT_EQ(sizes, (vector<size_t>{3, 3, 3, 3}));
+}
+
+TEST(ThreadPool, pinning_policies) {
+  using thp::platform::pin_policy;
+  // 2 packages x 2 cores x 2 hyperthreads, siblings are n and n+4
+  vector<thp::platform::cpu_info> cpus;
+  for (unsigned c = 0; c < 8; ++c)
+    cpus.push_back({c, (c % 4) / 2, c % 2});
+
+  EXPECT_TRUE(thp::platform::pin_order(pin_policy::eNone, cpus).empty());
+  EXPECT_EQ(thp::platform::pin_order(pin_policy::eCompact, cpus),
+            (vector<unsigned>{0, 4, 1, 5, 2, 6, 3, 7}));
+  EXPECT_EQ(thp::platform::pin_order(pin_policy::ePhysicalCores, cpus),
+            (vector<unsigned>{0, 1, 2, 3}));
+  EXPECT_EQ(thp::platform::pin_order(pin_policy::eScatter, cpus),
+            (vector<unsigned>{0, 2, 1, 3, 4, 6, 5, 7}));
+  EXPECT_EQ(thp::platform::pin_order(pin_policy::eExplicit, cpus).front(), 0u);
+
+  // every worker is bound to a single cpu before running tasks. the latch
+  // holds each task till all are running, so each worker runs one of them
+  constexpr unsigned n = 3;
+  thp::threadpool tp(thp::pool_options{.max_threads = n, .pinning = pin_policy::eCompact});
+  std::latch all_running{n};
+  vector<thp::future<std::pair<thread::id, int>>> futs;
+  for (unsigned i = 0; i < n; ++i)
+    futs.emplace_back(tp.submit([&all_running] {
+      all_running.arrive_and_wait();
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      sched_getaffinity(0, sizeof(set), &set);
+      return std::make_pair(this_thread::get_id(), CPU_COUNT(&set));
+    }));
+  std::set<thread::id> workers;
+  for (auto &f : futs) {
+    auto [id, cpus] = f.get();
+    workers.insert(id);
+    EXPECT_EQ(cpus, 1);
+  }
+  EXPECT_EQ(workers.size(), n);
+}
+
+TEST(ThreadPool, rt_lane) {
+  thp::threadpool tp(thp::pool_options{.max_threads = 2, .rt = {.threads = 1, .threshold = 10}});
+  auto policy = [] { return sched_getscheduler(0); };
+
+  auto urgent = tp.submit_priority(100, policy);
+  auto bulk = tp.submit_priority(1, policy);
+  if (tp.realtime_workers() > 0)
+    EXPECT_EQ(urgent.get(), SCHED_FIFO);
+  else
+    EXPECT_EQ(urgent.get(), SCHED_OTHER);
+  EXPECT_EQ(bulk.get(), SCHED_OTHER);
+
+  // without a lane every priority runs on the pool
+  thp::threadpool plain(2);
+  EXPECT_EQ(plain.submit_priority(100, [] { return 7; }).get(), 7);
+}
+
+TEST(ThreadPool, elastic_grows_and_retires) {
+  using namespace std::chrono_literals;
+  for (auto algo : {thp::sch::eOneshot, thp::sch::eWaiting, thp::sch::eWorkStealing}) {
+    thp::threadpool tp(thp::pool_options{
+        .max_threads = 4, .algo = algo,
+        .elastic = {.min_threads = 1, .grow_after = 0ms, .keep_alive = 20ms}});
+    EXPECT_EQ(tp.running_workers(), 1u) << "algo " << static_cast<int>(algo);
+
+    // twice, retired slots get new threads
+    for (int round = 0; round < 2; ++round) {
+      atomic<bool> go{false};
+      vector<thp::future<int>> futs;
+      for (int i = 0; i < 16; ++i)
+        futs.emplace_back(tp.submit([&go, i] { go.wait(false); return i; }));
+      EXPECT_TRUE(eventually([&] { return tp.running_workers() == 4; })) << "algo " << static_cast<int>(algo);
+
+      go = true;
+      go.notify_all();
+      int s = 0;
+      for (auto &f : futs)
+        s += f.get();
+      EXPECT_EQ(s, 15 * 16 / 2);
+      EXPECT_TRUE(eventually([&] { return tp.running_workers() == 1; })) << "algo " << static_cast<int>(algo);
+    }
+  }
+}
+
+TEST(ThreadPool, elastic_keeps_handoff_of_paused_worker) {
+  using namespace std::chrono_literals;
+  for (auto algo : {thp::sch::eOneshot, thp::sch::eWaiting, thp::sch::eWorkStealing}) {
+    thp::threadpool tp(thp::pool_options{
+        .max_threads = 2, .algo = algo, .dispatch = thp::dispatch_mode::eDirect,
+        .elastic = {.min_threads = 1, .grow_after = 0ms, .keep_alive = 20ms}});
+
+    // grow to two workers, so one of them may retire later
+    atomic<bool> go{false};
+    vector<thp::future<int>> futs;
+    for (int i = 0; i < 8; ++i)
+      futs.emplace_back(tp.submit([&go, i] { go.wait(false); return i; }));
+    EXPECT_TRUE(eventually([&] { return tp.running_workers() == 2; })) << "algo " << static_cast<int>(algo);
+    go = true;
+    go.notify_all();
+    for (auto &f : futs)
+      f.get();
+
+    // an idle worker takes the task while paused, then stays idle past
+    // keep_alive
+    tp.pause();
+    auto f = tp.submit([] { return 42; });
+    this_thread::sleep_for(100ms);
+    tp.resume();
+
+    EXPECT_TRUE(eventually([&] { return f.ready(); })) << "algo " << static_cast<int>(algo);
+    if (f.ready()) {
+      EXPECT_EQ(f.get(), 42);
+      tp.drain();
+    }
+  }
+}
+
+TEST(ThreadPool, deadline_tasks_run_earliest_first) {
+  using namespace std::chrono_literals;
+  for (auto policy : {thp::deadline_policy::eRun, thp::deadline_policy::eDrop}) {
+    thp::threadpool tp(thp::pool_options{.max_threads = 1, .on_deadline_miss = policy});
+    atomic<bool> go{false};
+    auto blocker = tp.submit([&go] { go.wait(false); });
+
+    // one worker, busy till go, so deadline tasks pile up
+    const auto now = thp::deadline_clock::now();
+    vector<int> order;
+    vector<thp::future<void>> futs;
+    for (int i : {3, 1, 2})
+      futs.emplace_back(tp.submit_deadline(now + i * 10s, [&order, i] { order.push_back(i); }));
+    auto late = tp.submit_deadline(now - 1s, [&order] { order.push_back(0); });
+
+    go = true;
+    go.notify_all();
+    blocker.get();
+    for (auto &f : futs)
+      f.get();
+
+    const auto st = tp.deadline_statistics();
+    EXPECT_EQ(st.met, 3u);
+    if (policy == thp::deadline_policy::eRun) {
+      late.get();
+      EXPECT_EQ(order, (vector<int>{0, 1, 2, 3}));
+      EXPECT_EQ(st.missed, 1u);
+    } else {
+      EXPECT_THROW(late.get(), std::future_error);
+      EXPECT_EQ(order, (vector<int>{1, 2, 3}));
+      EXPECT_EQ(st.dropped, 1u);
+    }
+  }
+}
+
+TEST(ThreadPool, timers) {
+  using namespace std::chrono_literals;
+  thp::threadpool tp(2);
+  std::promise<chrono::steady_clock::time_point> once;
+  atomic<int> ticks{0}, cancelled{0};
+
+  const auto start = chrono::steady_clock::now();
+  tp.schedule_after(20ms, [&once] { once.set_value(chrono::steady_clock::now()); });
+  auto dropped = tp.schedule_after(10ms, [&cancelled] { ++cancelled; });
+  auto every = tp.schedule_every(2ms, [&ticks] { ++ticks; });
+  EXPECT_TRUE(dropped.cancel());
+
+  EXPECT_GE(once.get_future().get() - start, 20ms);
+  while (ticks.load() < 3)
+    this_thread::sleep_for(1ms);
+  EXPECT_TRUE(every.cancel());
+  EXPECT_FALSE(every.cancel());
+  EXPECT_EQ(cancelled.load(), 0);
+}
+
+TEST(QueueSelection, weighted_fair_share) {
+  thp::priority_taskq<int> a, b, late;
+  for (int i = 0; i < 1000; ++i) {
+    a.push(thp::priority_task<int>{[] {}});
+    b.push(thp::priority_task<int>{[] {}});
+  }
+  thp::statistics stats{};
+  stats.jobq.in.qs = {&a, &b, &late};
+  thp::algos::queue_select::fairshare_algo algo({1, 3, 1});
+
+  map<thp::task_queue *, int> picks;
+  for (int i = 0; i < 400; ++i)
+    ++picks[algo.apply(stats)];
+  EXPECT_EQ(picks[&a], 100);
+  EXPECT_EQ(picks[&b], 300);
+
+  // a queue getting work late has no credit for its idle time
+  late.push(thp::priority_task<int>{[] {}});
+  picks.clear();
+  for (int i = 0; i < 5; ++i)
+    ++picks[algo.apply(stats)];
+  EXPECT_LE(picks[&late], 1);
+
+  thp::priority_taskq<int> empty;
+  stats.jobq.in.qs = {&empty};
+  EXPECT_EQ(thp::algos::queue_select::fairshare_algo({1}).apply(stats), nullptr);
+}
+
+TEST(ThreadPool, fair_share_reports_shares) {
+  using namespace std::chrono_literals;
+  for (auto algo : {thp::sch::eOneshot, thp::sch::eWaiting, thp::sch::eWorkStealing}) {
+    // one worker and tasks longer than a time slice, so every pick runs
+    // exactly one task and task counts follow the picks
+    thp::threadpool tp(thp::pool_options{.max_threads = 1, .algo = algo, .queue_weights = {1, 3, 1}});
+    atomic<int> done{0}, ran[2]{0, 0}, seen[2]{0, 0};
+    auto spin = [&](int q, int i) {
+      for (auto end = chrono::steady_clock::now() + 1ms; chrono::steady_clock::now() < end;) {}
+      ++ran[q];
+      if (++done == 40) {
+        seen[0] = ran[0].load();
+        seen[1] = ran[1].load();
+      }
+      return i;
+    };
+    vector<thp::future<int>> futs;
+    // queue everything first so both queues stay backlogged over the picks
+    tp.pause();
+    for (int i = 0; i < 40; ++i) {
+      futs.emplace_back(tp.submit([spin, i] { return spin(0, i); }));
+      futs.emplace_back(tp.submit_priority(i, [spin, i] { return spin(1, i); }));
+    }
+    tp.resume();
+
+    int s = 0;
+    for (auto &f : futs)
+      s += f.get();
+    EXPECT_EQ(s, 2 * 39 * 40 / 2) << "algo " << static_cast<int>(algo);
+
+    // 1 to 3 over the first 40 picks, give or take the picks before resume
+    EXPECT_GE(seen[0].load(), 7) << "algo " << static_cast<int>(algo);
+    EXPECT_GE(seen[1].load(), 2 * seen[0].load()) << "algo " << static_cast<int>(algo);
+
+    const auto shares = tp.queue_shares();
+    ASSERT_EQ(shares.size(), 3u);
+    EXPECT_NEAR(shares[0] + shares[1] + shares[2], 1.0, 1e-9);
+  }
+}
+
+TEST(ThreadPool, tenant_quota) {
+  using namespace std::chrono_literals;
+  for (auto algo : {thp::sch::eOneshot, thp::sch::eWaiting, thp::sch::eWorkStealing}) {
+    thp::threadpool tp(thp::pool_options{
+        .max_threads = 4, .algo = algo, .tenants = {{.max_concurrency = 1}, {.weight = 2}}});
+    atomic<int> running{0}, peak{0};
+    vector<thp::future<int>> futs;
+    for (int i = 0; i < 20; ++i) {
+      futs.emplace_back(tp.submit(thp::tenant_id{0}, [&running, &peak, i] {
+        const int now = ++running;
+        int p = peak.load();
+        while (now > p && !peak.compare_exchange_weak(p, now)) {}
+        this_thread::sleep_for(100us);
+        --running;
+        return i;
+      }));
+      futs.emplace_back(tp.submit(thp::tenant_id{1}, [i] { return i; }));
+    }
+    int s = 0;
+    for (auto &f : futs)
+      s += f.get();
+    EXPECT_EQ(s, 2 * 19 * 20 / 2) << "algo " << static_cast<int>(algo);
+    EXPECT_EQ(peak.load(), 1) << "algo " << static_cast<int>(algo);
+
+    // counted once the task returned, a little after its future is ready
+    while (tp.tenant_statistics(thp::tenant_id{0}).completed < 20)
+      this_thread::yield();
+    const auto st = tp.tenant_statistics(thp::tenant_id{0});
+    EXPECT_EQ(st.submitted, 20u);
+    EXPECT_EQ(st.queued, 0u);
+    EXPECT_THROW(tp.submit(thp::tenant_id{2}, [] {}), std::out_of_range);
+  }
+}
+
+TEST(ThreadPool, tenant_at_quota_needs_no_workers) {
+  using namespace std::chrono_literals;
+  for (auto algo : {thp::sch::eOneshot, thp::sch::eWaiting, thp::sch::eWorkStealing}) {
+    for (bool elastic : {false, true}) {
+      thp::threadpool tp(thp::pool_options{
+          .max_threads = 2, .algo = algo,
+          .elastic = {.min_threads = elastic ? 1u : 0u, .grow_after = 0ms, .keep_alive = 1s},
+          .tenants = {{.max_concurrency = 1}}});
+      atomic<bool> go{false}, started{false};
+      vector<thp::future<int>> futs;
+      for (int i = 0; i < 8; ++i)
+        futs.emplace_back(tp.submit(thp::tenant_id{0}, [&go, &started, i] {
+          started = true;
+          go.wait(false);
+          return i;
+        }));
+      while (!started)
+        this_thread::sleep_for(1ms);
+
+      // the tasks held back by the quota neither keep the idle worker busy
+      // nor grow the pool
+      const auto cpu = std::clock();
+      this_thread::sleep_for(50ms);
+      EXPECT_LT(std::clock() - cpu, CLOCKS_PER_SEC / 50) << "algo " << static_cast<int>(algo);
+      if (elastic) {
+        EXPECT_EQ(tp.running_workers(), 1u) << "algo " << static_cast<int>(algo);
+      }
+
+      go = true;
+      go.notify_all();
+      int s = 0;
+      for (auto &f : futs)
+        s += f.get();
+      EXPECT_EQ(s, 7 * 8 / 2) << "algo " << static_cast<int>(algo);
+    }
+  }
+}
+
+TEST(ThreadPool, cancellable_tasks) {
+  thp::threadpool tp(thp::pool_options{.max_threads = 1});
+  atomic<bool> started{false}, ran{false};
+
+  // occupies the only worker until its stop token is set
+  auto running = tp.submit_cancellable([&started](std::stop_token st, int x) {
+    started = true;
+    while (!st.stop_requested())
+      this_thread::yield();
+    return x;
+  }, 7);
+  while (!started)
+    this_thread::yield();
+
+  auto queued = tp.submit_cancellable([&ran] { ran = true; });
+  auto kept = tp.submit_cancellable([](int x) { return x + 1; }, 1);
+  EXPECT_TRUE(queued.cancel());
+  EXPECT_FALSE(running.cancel());
+  EXPECT_EQ(running.get(), 7);
+  EXPECT_EQ(kept.get(), 2);
+  EXPECT_THROW(queued.get(), thp::task_cancelled);
+  EXPECT_FALSE(ran.load());
+  EXPECT_FALSE(kept.cancel());
+}
+
+TEST(ThreadPool, pause_resume_drain) {
+  using namespace std::chrono_literals;
+  for (auto algo : {thp::sch::eOneshot, thp::sch::eWaiting, thp::sch::eWorkStealing}) {
+    thp::threadpool tp(thp::pool_options{.max_threads = 4, .algo = algo});
+    atomic<int> done{0};
+
+    tp.pause();
+    for (int i = 0; i < 100; ++i)
+      tp.post([&done] { ++done; });
+    auto f = tp.submit([] { return 1; });
+    this_thread::sleep_for(20ms);
+    EXPECT_EQ(done.load(), 0) << "algo " << static_cast<int>(algo);
+    EXPECT_FALSE(f.ready()) << "algo " << static_cast<int>(algo);
+
+    tp.resume();
+    tp.drain();
+    EXPECT_EQ(done.load(), 100) << "algo " << static_cast<int>(algo);
+    EXPECT_EQ(f.get(), 1);
+
+    for (int i = 0; i < 50; ++i)
+      tp.post([&done] {
+        this_thread::sleep_for(50us);
+        ++done;
+      });
+    tp.drain();
+    EXPECT_EQ(done.load(), 150) << "algo " << static_cast<int>(algo);
+  }
+}
+
+TEST(ThreadPool, bounded_queue_overflow) {
+  using namespace std::chrono_literals;
+  auto pool = [](thp::overflow_policy p) {
+    return std::make_unique<thp::threadpool>(
+        thp::pool_options{.max_threads = 1, .queue_capacity = 2, .on_overflow = p});
+  };
+  // keeps the only worker busy till release is set
+  auto occupy = [](thp::threadpool &tp, atomic<bool> &release) {
+    atomic<bool> started{false};
+    auto f = tp.submit([&] {
+      started = true;
+      while (!release)
+        this_thread::yield();
+    });
+    while (!started)
+      this_thread::yield();
+    return f;
+  };
+
+  {
+    auto tp = pool(thp::overflow_policy::eBlock);
+    atomic<bool> release{false};
+    auto busy = occupy(*tp, release);
+    auto a = tp->submit([] { return 1; });
+    auto b = tp->submit([] { return 2; });
+    EXPECT_FALSE(tp->try_submit([] { return 3; }).has_value());
+
+    atomic<bool> submitted{false};
+    thread producer([&] {
+      EXPECT_EQ(tp->submit([] { return 4; }).get(), 4);
+      submitted = true;
+    });
+    this_thread::sleep_for(10ms);
+    EXPECT_FALSE(submitted.load());
+    release = true;
+    producer.join();
+    EXPECT_EQ(a.get() + b.get(), 3);
+    const auto st = tp->queue_statistics().front();
+    EXPECT_EQ(st.capacity, 2u);
+    EXPECT_EQ(st.rejected, 1u);
+    EXPECT_EQ(st.blocked, 1u);
+  }
+  {
+    auto tp = pool(thp::overflow_policy::eCallerRuns);
+    atomic<bool> release{false};
+    auto busy = occupy(*tp, release);
+    tp->post([] {});
+    tp->post([] {});
+    // try_submit neither runs the task here nor queues it
+    atomic<bool> ran{false};
+    EXPECT_FALSE(tp->try_submit([&ran] { ran = true; }).has_value());
+    EXPECT_FALSE(ran.load());
+    const auto caller = this_thread::get_id();
+    EXPECT_EQ(tp->submit([] { return this_thread::get_id(); }).get(), caller);
+    release = true;
+    tp->drain();
+    EXPECT_FALSE(ran.load());
+    EXPECT_EQ(tp->queue_statistics().front().rejected, 2u);
+  }
+  {
+    auto tp = pool(thp::overflow_policy::eDropOldest);
+    atomic<bool> release{false};
+    auto busy = occupy(*tp, release);
+    auto a = tp->submit([] { return 1; });
+    auto b = tp->submit([] { return 2; });
+    auto c = tp->submit([] { return 3; });
+    release = true;
+    EXPECT_THROW(a.get(), std::future_error);
+    EXPECT_EQ(b.get() + c.get(), 5);
+    EXPECT_EQ(tp->queue_statistics().front().rejected, 1u);
+  }
+}
+
+TEST(ThreadPool, post) {
+  thp::threadpool tp(4);
+  constexpr int n = 1000;
+  atomic<int> done{0};
+
+  for (int i = 0; i < n; ++i)
+    tp.post([&done](int x) { done.fetch_add(x); }, 1);
+
+  while (done.load() != n)
+    this_thread::yield();
+  EXPECT_EQ(done.load(), n);
+}
+
+} // namespace